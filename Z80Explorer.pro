@@ -14,9 +14,12 @@ DEFINES += QT_DEPRECATED_WARNINGS
 win32 {
 DEFINES += WINDOWS
 DEFINES += _CRT_SECURE_NO_WARNINGS
-# AVX2 support for optimized simulation (widely supported on CPUs from 2013+)
-QMAKE_CXXFLAGS += /arch:AVX2
 }
+# No /arch or -m flags: the optimized simulator selects its SSE2, AVX2 or AVX-512 kernels at runtime
+# The simulator with the compiled netlist (ClassSimZ80_Compiled) is built only by CMake, option Z80_COMPILED_SIM
+# The command-line tools (z80explorer-cli, z80explorer-bench) are also built only by CMake
+# Uncomment to count the optimized simulator's internal events (script command perf(), Sim Monitor panel)
+#DEFINES += SIM_PERF_COUNTERS=1
 
 # You can also make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
@@ -28,12 +31,15 @@ SOURCES += \
     src/ClassApplog.cpp \
     src/ClassColors.cpp \
     src/ClassController.cpp \
+    src/ClassExport.cpp \
     src/ClassLogic.cpp \
     src/ClassNetlist.cpp \
     src/ClassScript.cpp \
     src/ClassServer.cpp \
     src/ClassSimZ80.cpp \
     src/ClassSimZ80_AVX2.cpp \
+    src/ClassSimZ80_Emu.cpp \
+    src/ClassSimZ80_Batch.cpp \
     src/ClassTip.cpp \
     src/ClassTrickbox.cpp \
     src/ClassVisual.cpp \
@@ -74,6 +80,8 @@ HEADERS += \
     src/ClassServer.h \
     src/ClassSimZ80.h \
     src/ClassSimZ80_AVX2.h \
+    src/ClassSimZ80_Emu.h \
+    src/ClassSimZ80_Batch.h \
     src/ClassSingleton.h \
     src/ClassTip.h \
     src/ClassTrickbox.h \
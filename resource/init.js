@@ -15,6 +15,7 @@ function writeIO(address, value) { mon.writeIO(address, value); }
 function stopAt(hc) { mon.stopAt(hc); }
 function breakWhen(net, value) { mon.breakWhen(net, value); }
 function set(name, value) { mon.set(name, value); }
+function setPins(values) { mon.setPins(values); }
 function setAt(name, hcycle, hold) { mon.setAt(name, hcycle, hold); }
 function setAtPC(name, address, hold) { mon.setAtPC(name, address, hold); }
 function setLayer(id) { img.setLayer(id); }
@@ -51,25 +52,19 @@ function key(code, ctrl)
     // F8 - run 2 half cycles forward
     if ((code == 0x1000037) && (ctrl == 0))
         run(2);
-    // Ctrl + F7 - run 1 half cycle back (by reset and rerun)
+    // Ctrl + F7 - run 1 half cycle back (from the nearest checkpoint)
     if ((code == 0x1000036) && (ctrl == 1))
     {
         cycle = mon.getHCycle();
         if (cycle >= 10)
-        {
-            reset();
-            run(cycle - 9);
-        }
+            rewind(cycle - 1);
     }
-    // Ctrl + F8 - run 2 half cycles back (by reset and rerun)
+    // Ctrl + F8 - run 2 half cycles back (from the nearest checkpoint)
     if ((code == 0x1000037) && (ctrl == 1))
     {
         cycle = mon.getHCycle();
         if (cycle >= 11)
-        {
-            reset();
-            run(cycle - 10);
-        }
+            rewind(cycle - 2);
     }
     //-------------------------------------------------------------------------------
 }
@@ -103,11 +98,21 @@ function help()
     print("run(hcycles)       - Runs the simulation for the given number of half-clocks or 0 for all");
     print("stop()             - Stops the running simulation");
     print("reset()            - Resets the simulation state");
+    print("rewind(hcycle)     - Rewinds the simulation to the given half-cycle, from the nearest checkpoint");
+    print("fastForward(hc,pc) - Emulates the program from the reset to a half-cycle or a PC (-1 for none), then continues on the netlist");
+    print("lockstep(hc,every) - Runs the optimized and the reference simulator in lockstep, comparing all nets every N half-cycles");
+    print("saveState(\"file\")  - Saves the complete simulation state (chip, RAM, IO, trickbox) into a file");
+    print("loadState(\"file\")  - Loads the simulation state from a file, in place of a reset");
     print("t(trans)           - Shows a transistor state");
     print("n(net|\"name\")      - Shows a net state by net number or net \"name\"");
     print("eq(net|\"name\")     - Computes and shows the logic equation that drives a given net");
+    print("exportVerilog(\"file\") - Exports the chip model as a gate-level Verilog module");
+    print("exportC(\"file\")    - Exports the chip model as a standalone C model");
     print("print(\"msg\")       - Prints a string message");
     print("relatch()          - Reloads all custom latches from 'latches.ini' file");
+    print("stats()            - Shows the simulator statistics (group cache, bit slices, skipped loops, static gates) since the last reset");
+    print("perf()             - Shows the simulator performance counters since the last reset");
+    print("perfCounters()     - Returns the simulator performance counters as an object (waves, groupSizes,...)");
     print("save()             - Saves all changes to all custom and config files");
     print("exec(\"path\",\"args\")- Runs external executable");
     print("-- Object 'monitor' methods:");
@@ -125,10 +130,21 @@ function help()
     print("mon.stopAt(hcycle) - Stops the simulation at a given half-cycle number");
     print("mon.breakWhen(net,value) - Stops the simulation when a given net number becomes 0 or 1");
     print("mon.set(\"name\",value) - Sets an output pin (\"int\",...) to a value");
+    print("mon.setPins({name:value,...}) - Sets several output pins to values at once, settling the chip once");
     print("mon.setAt(\"name\",hcycle,hold) - Activates an output pin at hcycle and holds it for hcycles");
     print("mon.setAtPC(\"name\",address,hold) - Activates an output pin when PC equals the address and holds it for hcycles");
     print("mon.enabled = [1|0] - Variable: Enables or disables monitor’s memory mapped services at the address 0xD000");
     print("mon.rom = [size] - Variable: Designates initial length as read-only memory");
+    print("-- Object 'batch' methods (64 chip instances simulated at once):");
+    print("batch.init(lanes) - Resets all lanes; each lane gets a copy of the simulated memory and IO space");
+    print("batch.setAt(lane,\"name\",hcycle,hold) - Activates an output pin in one lane at hcycle and holds it for hcycles");
+    print("batch.setAtPC(lane,\"name\",address,hold) - Activates an output pin in one lane when PC equals the address");
+    print("batch.stopAt(hcycle) - Stops every lane at a given half-cycle number");
+    print("batch.run(hcycles) - Runs all lanes for the given number of half-clocks or 0 until they all stop");
+    print("batch.stop() - Stops the running batch");
+    print("batch.readState(lane) - Returns the chip state of a lane");
+    print("batch.getOutput(lane) - Returns the console output of a lane");
+    print("batch.readMem(lane,addr) - Reads a byte from the simulated memory of a lane");
     print("--- Object 'image' methods:");
     print("img.setLayer(id) - Sets the layer id ('1'...'k'");
     print("img.addLayer(id) - Adds the layer id ('1'...'k' to the existing image");
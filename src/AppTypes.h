@@ -4,9 +4,18 @@
 #define APP_VERSION 109 // Application version (minor % 100)
 #define USE_PERFORMANCE_SIM 1 // Use faster and optimized (but more obfuscated) simulation code
 #define USE_AVX2_SIM 1 // Use optimized simulation with AVX2/x64 intrinsics
+#ifndef USE_COMPILED_SIM
+#define USE_COMPILED_SIM 0 // Use optimized simulation with the netlist compiled in (set by the CMake option Z80_COMPILED_SIM)
+#endif
 #define HAVE_PREBUILT_LAYERMAP 1 // We have extracted a fully prebuilt layermap.bin and can use it
 #define FIX_Z80_LAYERMAP_TO_VISUAL_ENUM 1 // Fix to prebuilt layermap incorrectly counting nets between 1559 and 1710
 #define SOCKET_SERVER 0 // Enable command socket server on port 12345
+#ifndef SIM_PERF_COUNTERS
+#define SIM_PERF_COUNTERS 0 // Count the optimized simulator's internal events (set by the CMake option Z80_PERF_COUNTERS)
+#endif
+#ifndef HEADLESS_CLI
+#define HEADLESS_CLI 0 // Build the command-line runner, without the GUI classes (set by the z80explorer-cli target)
+#endif
 
 #include <stdint.h>
 
@@ -15,6 +15,10 @@ bool ClassController::init(QJSEngine *sc)
     // Java engine should not garbage collect or otherwise destruct these objects
     sc->setObjectOwnership(&m_script, QJSEngine::CppOwnership);
     sc->setObjectOwnership(&m_trick, QJSEngine::CppOwnership);
+#if USE_AVX2_SIM
+    sc->globalObject().setProperty("batch", sc->newQObject(&m_batch));
+    sc->setObjectOwnership(&m_batch, QJSEngine::CppOwnership);
+#endif
 
     m_script.init(sc);
 
@@ -26,6 +30,7 @@ bool ClassController::init(QJSEngine *sc)
     connect(this, &ClassController::shutdown, &m_simz80, &ClassSimZ80::onShutdown);
 #if USE_AVX2_SIM
     connect(this, &ClassController::shutdown, &m_simz80avx2, &ClassSimZ80_AVX2::onShutdown);
+    connect(this, &ClassController::shutdown, &m_batch, &ClassSimZ80_Batch::stop);
 #endif
     connect(this, &ClassController::shutdown, &m_tips, &ClassTip::onShutdown);
     connect(this, &ClassController::shutdown, &m_watch, &ClassWatch::onShutdown);
@@ -70,6 +75,8 @@ bool ClassController::init(QJSEngine *sc)
         qCritical() << "Unable to initialize AVX2 optimized simulator from" << resDir;
         return false;
     }
+    if (!m_batch.loadNetlist(m_simz80avx2))
+        qWarning() << "Unable to initialize the batch simulator";
     qInfo() << "AVX2 optimized simulator initialized successfully";
 #endif
 
@@ -141,6 +148,87 @@ uint ClassController::doReset()
     return hcycle;
 }
 
+/*
+ * Rewinds the simulation to the given half-cycle
+ * The optimized simulator restores its nearest checkpoint and re-simulates the remainder; otherwise, the chip is
+ * reset and run again
+ */
+void ClassController::doRewind(uint hcycle)
+{
+    if (isSimRunning())
+        return;
+#if USE_AVX2_SIM
+    if (m_simz80avx2.rewind(hcycle))
+        return;
+#endif
+    uint start = doReset();
+    if (hcycle > start)
+        doRunsim(hcycle - start);
+}
+
+/*
+ * Emulates the program from the reset up to a half-cycle, or a PC address (if not -1), on the instruction-level
+ * emulator, and continues on the netlist from there
+ */
+bool ClassController::doFastForward(uint hcycles, int pc)
+{
+#if USE_AVX2_SIM
+    if (isSimRunning())
+        return false;
+    m_watch.clear(); // Clear watch signal history
+    m_trick.reset(); // Reset the control counters etc.
+    return m_simz80avx2.fastForward(hcycles, pc);
+#else
+    qWarning() << "Fast-forward is supported only by the optimized simulator";
+    return false;
+#endif
+}
+
+/*
+ * Runs the optimized and the reference simulator in lockstep from the current chip state, comparing the states of
+ * all nets and transistors every given number of half-cycles; returns false at the first divergence
+ */
+bool ClassController::doLockstep(uint hcycles, uint every)
+{
+#if USE_AVX2_SIM
+    if (isSimRunning())
+        return false;
+    return m_simz80avx2.lockstep(m_simz80, hcycles, every);
+#else
+    qWarning() << "Lockstep validation needs the optimized simulator";
+    return false;
+#endif
+}
+
+/*
+ * Saves the complete simulation state into a file
+ */
+bool ClassController::saveState(QString fileName)
+{
+#if USE_AVX2_SIM
+    return m_simz80avx2.saveState(fileName);
+#else
+    qWarning() << "Simulation state files are supported only by the optimized simulator";
+    return false;
+#endif
+}
+
+/*
+ * Loads the simulation state from a file, which takes the place of a chip reset
+ */
+bool ClassController::loadState(QString fileName)
+{
+#if USE_AVX2_SIM
+    if (isSimRunning())
+        return false;
+    m_watch.clear(); // Clear watch signal history
+    return m_simz80avx2.loadState(fileName);
+#else
+    qWarning() << "Simulation state files are supported only by the optimized simulator";
+    return false;
+#endif
+}
+
 /*
  * Runs the simulation for the given number of clocks
  */
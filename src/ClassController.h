@@ -2,6 +2,9 @@
 #define CLASSCONTROLLER_H
 
 #include "AppTypes.h"
+#if HEADLESS_CLI
+#include "ClassControllerCli.h" // The command-line runner has its own controller, without the GUI classes
+#else
 #include "ClassAnnotate.h"
 #include "ClassVisual.h"
 #include "ClassColors.h"
@@ -10,6 +13,10 @@
 #include "ClassSimZ80.h"
 #if USE_AVX2_SIM
 #include "ClassSimZ80_AVX2.h"
+#include "ClassSimZ80_Batch.h"
+#endif
+#if USE_COMPILED_SIM
+#include "ClassSimZ80_Compiled.h"
 #endif
 #include "ClassTip.h"
 #include "ClassTrickbox.h"
@@ -33,6 +40,7 @@ public: // API
     inline ClassServer   &getServer()     { return m_server; }    // Returns a reference to the server class
 #if USE_AVX2_SIM
     inline ClassSimZ80_AVX2 &getSimZ80()  { return m_simz80avx2; } // Returns a reference to the AVX2 optimized Z80 simulator
+    inline ClassSimZ80_Batch &getBatch()  { return m_batch; }     // Returns a reference to the 64-lane batch simulator
 #else
     inline ClassSimZ80   &getSimZ80()     { return m_simz80; }    // Returns a reference to the Z80 simulator class
 #endif
@@ -86,6 +94,11 @@ public: // API
 public slots:
     uint doReset();                         // Runs the chip reset sequence, returns the number of clocks thet reset took
     void doRunsim(uint ticks);              // Runs the simulation for the given number of clocks
+    void doRewind(uint hcycle);             // Rewinds the simulation to the given half-cycle
+    bool doFastForward(uint hcycles, int pc = -1); // Emulates the program from the reset up to a half-cycle or a PC address
+    bool doLockstep(uint hcycles, uint every = 1); // Runs both simulators in lockstep, comparing their states
+    bool saveState(QString fileName);       // Saves the complete simulation state into a file
+    bool loadState(QString fileName);       // Loads the simulation state from a file
     void save() { emit shutdown(); }        // Saves all modified files
 
 signals:
@@ -104,8 +117,13 @@ private:
     ClassScript   m_script;     // Global scripting support
     ClassServer   m_server;     // Global socket server class
     ClassSimZ80   m_simz80;     // Global Z80 simulator class (always needed for netlist)
-#if USE_AVX2_SIM
+#if USE_COMPILED_SIM
+    ClassSimZ80_Compiled m_simz80avx2; // AVX2 optimized Z80 simulator with the netlist compiled in
+#elif USE_AVX2_SIM
     ClassSimZ80_AVX2 m_simz80avx2; // AVX2 optimized Z80 simulator class
+#endif
+#if USE_AVX2_SIM
+    ClassSimZ80_Batch m_batch;  // Bit-parallel simulator running up to 64 chip instances at once
 #endif
     ClassWatch    m_watch;      // Global watchlist
     ClassTip      m_tips;       // Global tips
@@ -114,4 +132,5 @@ private:
 
 extern ClassController controller;
 
+#endif // HEADLESS_CLI
 #endif // CLASSCONTROLLER_H
@@ -0,0 +1,92 @@
+#include "ClassController.h"
+#include <QDebug>
+#include <QDir>
+#include <QEventLoop>
+
+/*
+ * Loads the chip resources from the given folder for the given simulation engines, and selects the first one
+ * The tools do not load the watchlist, tips or the chip layout
+ */
+bool ClassController::init(const QString resDir, const QList<SimEngine> &engines)
+{
+    QDir::setCurrent(resDir);
+    for (SimEngine engine : engines)
+    {
+        bool ok = false;
+#if USE_AVX2_SIM
+        if (engine == SimEngine::Optimized)
+        {
+            connect(this, &ClassController::shutdown, &m_sim.m_optimized, &ClassSimZ80_AVX2::onShutdown);
+            ok = m_sim.m_optimized.loadResources(resDir) && m_sim.m_optimized.initChip();
+        }
+#endif
+        if (engine == SimEngine::Reference)
+        {
+            connect(this, &ClassController::shutdown, &m_sim.m_reference, &ClassSimZ80::onShutdown);
+            ok = m_sim.m_reference.loadResources(resDir) && m_sim.m_reference.initChip();
+        }
+        if (!ok)
+        {
+            qCritical() << "Unable to load chip resources for the" << ClassSimCli::engineName(engine) << "simulator from" << resDir;
+            return false;
+        }
+    }
+    if (!engines.isEmpty())
+        m_sim.setEngine(engines.first());
+    return true;
+}
+
+/*
+ * Runs the chip reset sequence, returns the number of clocks thet reset took
+ */
+uint ClassController::doReset()
+{
+    m_watch.clear();
+    m_trick.reset();
+    uint hcycle = m_sim.doReset();
+    emit onRunStopped(hcycle);
+    return hcycle;
+}
+
+/*
+ * Emulates the program from the reset up to a half-cycle, or a PC address (if not -1), on the instruction-level
+ * emulator, and continues on the netlist from there
+ */
+bool ClassController::doFastForward(uint hcycles, int pc)
+{
+    m_watch.clear();
+    m_trick.reset();
+    return m_sim.fastForward(hcycles, pc);
+}
+
+/*
+ * Runs the optimized simulator from its current state with the reference simulator following it in lockstep, for the
+ * given number of clocks or until the trickbox stops it; both simulators need to be loaded
+ */
+bool ClassController::doLockstep(uint hcycles, uint every)
+{
+    return m_sim.lockstep(hcycles, every);
+}
+
+/*
+ * Runs the simulation for the given number of clocks
+ */
+void ClassController::doRunsim(uint ticks)
+{
+    m_sim.doRunsim(ticks);
+}
+
+/*
+ * Runs the simulation for the given number of clocks, or until the trickbox stops it, and waits for it to stop
+ * The simulation runs in its own thread; the event loop runs until the simulator signals that it stopped
+ */
+uint ClassController::runsim(uint ticks)
+{
+    const uint start = m_sim.getCurrentHCycle();
+    QEventLoop loop;
+    connect(this, &ClassController::onRunStopped, &loop, &QEventLoop::quit, Qt::QueuedConnection);
+    m_sim.doRunsim(ticks);
+    if (m_sim.isRunning())
+        loop.exec();
+    return m_sim.getCurrentHCycle() - start;
+}
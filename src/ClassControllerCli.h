@@ -0,0 +1,144 @@
+#ifndef CLASSCONTROLLERCLI_H
+#define CLASSCONTROLLERCLI_H
+
+#include "AppTypes.h"
+#include "ClassSimZ80.h"
+#if USE_AVX2_SIM
+#include "ClassSimZ80_AVX2.h"
+#endif
+#if USE_COMPILED_SIM
+#include "ClassSimZ80_Compiled.h"
+#endif
+#include "ClassTip.h"
+#include "ClassTrickbox.h"
+#include "ClassWatch.h"
+
+// Simulation engines that the command-line tools select at runtime
+enum class SimEngine { Reference, Optimized };
+
+/*
+ * Forwards the simulator calls of the trickbox and of the command-line tools to the engine selected at runtime
+ */
+class ClassSimCli
+{
+public:
+    SimEngine getEngine() { return m_engine; }
+    void setEngine(SimEngine engine) { m_engine = engine; }
+    static const char *engineName(SimEngine engine)
+        { return (engine == SimEngine::Optimized) ? "optimized" : "reference"; }
+
+    uint doReset() { return call([](auto &sim) { return sim.doReset(); }); }
+    void doRunsim(uint ticks) { call([ticks](auto &sim) { sim.doRunsim(ticks); }); }
+    bool setPin(uint index, pin_t p) { return call([=](auto &sim) { return sim.setPin(index, p); }); }
+    bool setPins(uint mask, uint values) { return call([=](auto &sim) { return sim.setPins(mask, values); }); }
+    bool isRunning() { return call([](auto &sim) { return sim.isRunning(); }); }
+    uint16_t getPC() { return call([](auto &sim) { return sim.getPC(); }); }
+    uint getCurrentHCycle() { return call([](auto &sim) { return sim.getCurrentHCycle(); }); }
+    bool getNetState(net_t n) { return call([n](auto &sim) { return sim.getNetState(n); }); }
+    void readState(z80state &z) { call([&z](auto &sim) { sim.readState(z); }); }
+    quint64 getNetsRecalculated() { return call([](auto &sim) { return sim.getNetsRecalculated(); }); }
+#if USE_AVX2_SIM
+    bool saveState(const QString &fileName) { return (m_engine == SimEngine::Optimized) && m_optimized.saveState(fileName); }
+    bool loadState(const QString &fileName) { return (m_engine == SimEngine::Optimized) && m_optimized.loadState(fileName); }
+    bool fastForward(uint hcycles, int pc) { return (m_engine == SimEngine::Optimized) && m_optimized.fastForward(hcycles, pc); }
+    bool lockstep(uint hcycles, uint every) { return m_optimized.lockstep(m_reference, hcycles, every); }
+    bool loadConstants(const QString &fileName, bool observed) { return (m_engine == SimEngine::Optimized) && m_optimized.loadConstants(fileName, observed); }
+    net_t getFoldedChange() { return (m_engine == SimEngine::Optimized) ? m_optimized.getFoldedChange() : 0; }
+    void startTraining() { m_optimized.startTraining(); }
+    bool saveConstants(const QString &fileName) { return (m_engine == SimEngine::Optimized) && m_optimized.saveConstants(fileName); }
+#else
+    bool saveState(const QString &) { return false; }
+    bool loadState(const QString &) { return false; }
+    bool fastForward(uint, int) { return false; }
+    bool lockstep(uint, uint) { return false; }
+    bool loadConstants(const QString &, bool) { return false; }
+    net_t getFoldedChange() { return 0; }
+    void startTraining() {}
+    bool saveConstants(const QString &) { return false; }
+#endif
+
+    ClassSimZ80   m_reference;  // Z80 simulator class (always needed for netlist)
+#if USE_COMPILED_SIM
+    ClassSimZ80_Compiled m_optimized; // AVX2 optimized Z80 simulator with the netlist compiled in
+#elif USE_AVX2_SIM
+    ClassSimZ80_AVX2 m_optimized; // AVX2 optimized Z80 simulator class
+#endif
+
+private:
+    template <typename F> auto call(F f)
+    {
+#if USE_AVX2_SIM
+        if (m_engine == SimEngine::Optimized)
+            return f(m_optimized);
+#endif
+        return f(m_reference);
+    }
+#if USE_AVX2_SIM
+    SimEngine m_engine {SimEngine::Optimized};
+#else
+    SimEngine m_engine {SimEngine::Reference};
+#endif
+};
+
+/*
+ * Controller class of the command-line tools (z80explorer-cli and z80explorer-bench), built with HEADLESS_CLI
+ * It has the name and the API of the application controller that the simulator, trickbox and watch classes use,
+ * but none of the GUI, scripting and server classes, so the tools depend only on QtCore (and QtConcurrent)
+ */
+class ClassController : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ClassController() {};
+    bool init(const QString resDir, const QList<SimEngine> &engines); // Loads the chip resources for the given engines
+
+public: // API
+    inline ClassSimCli   &getSimZ80()     { return m_sim; }       // Returns a reference to the selected simulator
+    inline ClassWatch    &getWatch()      { return m_watch; }     // Returns a reference to the watch class
+    inline ClassNetlist  &getNetlist()    { return m_sim.m_reference; } // Returns a reference to the netlist class
+    inline ClassTip      &getTip()        { return m_tips; }      // Returns a reference to the tips class
+    inline ClassTrickbox &getTrickbox()   { return m_trick; }     // Returns a reference to the Trickbox class
+
+    inline uint8_t readMem(uint16_t ab)           // Reads from simulated RAM
+        { return m_trick.readMem(ab); }
+    inline void writeMem(uint16_t ab, uint8_t db) // Writes to simulated RAM
+        { m_trick.writeMem(ab, db); }
+    inline uint8_t readIO(uint16_t ab)            // Reads from simulated IO space
+        { return m_trick.readIO(ab); }
+    inline void writeIO(uint16_t ab, uint8_t db)  // Writes to simulated IO space
+        { m_trick.writeIO(ab, db); }
+    bool loadHex(QString fileName)                // Loads file into simulated RAM memory
+        { return m_trick.loadHex(fileName); }
+    void readState(z80state &state)               // Reads chip state structure
+        { m_sim.readState(state); }
+    bool isSimRunning()                           // Returns true is the simulation is currently running
+        { return m_sim.isRunning(); }
+
+    // Simulator calls this on every half-clock cycle
+    inline void onTick(uint ticks)
+        { m_trick.onTick(ticks); }
+
+    uint runsim(uint ticks);                // Runs the simulation until it stops, returns the number of half-cycles run
+
+public slots:
+    uint doReset();                         // Runs the chip reset sequence, returns the number of clocks thet reset took
+    void doRunsim(uint ticks);              // Runs the simulation for the given number of clocks
+    bool doFastForward(uint hcycles, int pc = -1); // Emulates the program from the reset up to a half-cycle or a PC address
+    bool doLockstep(uint hcycles, uint every = 1); // Runs both simulators in lockstep, comparing their states
+
+signals:
+    void onRunStarting(uint);               // Called by the sim when it is starting the simulation
+    void onRunHeartbeat(uint);              // Called by the sim every 500ms when running
+    void onRunStopped(uint);                // Called by the sim when the current run stops at a given half-cycle
+    void shutdown();                        // Application is shutting down
+
+private:
+    ClassSimCli   m_sim;        // Simulators
+    ClassWatch    m_watch;      // Watchlist; empty, since the tools do not record the signals
+    ClassTip      m_tips;       // Tips
+    ClassTrickbox m_trick;      // Trickbox supporting environment
+};
+
+extern ClassController controller;
+
+#endif // CLASSCONTROLLERCLI_H
@@ -0,0 +1,658 @@
+#include "ClassLogic.h"
+#include "ClassNetlist.h"
+#include <functional>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSet>
+#include <QTextStream>
+
+/*
+ * Exports the chip model extracted from the netlist as a gate-level Verilog module and as a standalone C model.
+ * Both exports share the same structure: the static gates (see getStaticGates()) become boolean expressions and
+ * every other transistor stays a switch. The module ports are the chip pads, named as in nodenames.js.
+ */
+#define EXPORT_MAX_SERIES 3 // Longest series of transistors in a static gate path (a 3-input NAND)
+
+// Chip pads, by their net names
+static const QStringList padInputs { "clk", "_int", "_nmi", "_busrq", "_wait", "_reset" };
+static const QStringList padControls { "_m1", "_mreq", "_iorq", "_rd", "_wr", "_rfsh", "_halt", "_busak" };
+static const QStringList padFloats { "_mreq", "_iorq", "_rd", "_wr" }; // And the address bus; can be in hi-Z
+
+static QStringList padBus(const QString &name, int width)
+{
+    QStringList list;
+    for (int i = 0; i < width; i++)
+        list.append(name + QString::number(i));
+    return list;
+}
+
+/*
+ * Returns a boolean expression of a static gate's logic tree; the leaf nets are written by the given function
+ */
+static QString exportExpr(const Logic *p, const std::function<QString(net_t)> &leaf, const QString &inv)
+{
+    QStringList terms;
+    for (const Logic *k : p->inputs)
+        terms.append(exportExpr(k, leaf, inv));
+    switch (p->op)
+    {
+        case LogicOp::Net: return leaf(p->outnet);
+        case LogicOp::Inverter: return inv + terms[0];
+        case LogicOp::And: return "(" + terms.join(" & ") + ")";
+        case LogicOp::Nand: return inv + "(" + terms.join(" & ") + ")";
+        case LogicOp::Nor: return inv + "(" + terms.join(" | ") + ")";
+        default: Q_ASSERT(0); return {};
+    }
+}
+
+static void purgeTree(Logic *p)
+{
+    for (Logic *k : p->inputs)
+        purgeTree(k);
+    delete p;
+}
+
+/*
+ * Returns the logic trees of the static gates: a pulled-up net, not a pad, whose transistors all lead to the ground,
+ * directly or in series through gateless nets that nothing else connects to. Such a net is low when any path conducts
+ * and high otherwise, so it is exactly an inverter, a NOR, a NAND or an AND-OR-INVERT gate of the path transistors'
+ * gate nets. The logic trees use the same operations as the schematics (see parse()), but unlike parse(), which
+ * stops at the selected terminating nets and tracks the clock gates and latches, this is a whole-chip, exact match.
+ * Each tree's root lists the transistors that the gate replaces; the caller purges the trees.
+ */
+QVector<Logic *> ClassNetlist::getStaticGates(const QVector<bool> &pad)
+{
+    QVector<Logic *> gates;
+    auto inSeries = [&](net_t x)
+    {
+        const Net &net = m_netlist[x];
+        return !pad[x] && !net.hasPullup && net.gates.isEmpty() && (net.c1c2s.count() == 2);
+    };
+    for (net_t n = nclk + 1; n < m_netlist.count(); n++)
+    {
+        const Net &net = m_netlist[n];
+        if (pad[n] || !net.hasPullup || net.c1c2s.isEmpty())
+            continue;
+        QVector<QVector<net_t>> paths; // Gate nets of the transistors of each path
+        QVector<Trans> trans;
+        bool ok = true;
+        for (int i = 0; (i < net.c1c2s.count()) && ok; i++)
+        {
+            QVector<net_t> path;
+            const Trans *t = net.c1c2s[i];
+            net_t from = n;
+            while (true)
+            {
+                const net_t to = (t->c1 == from) ? t->c2 : t->c1;
+                path.append(t->gate);
+                trans.append(*t);
+                ok = (to != n) && (to != from) && (to != npwr);
+                if (!ok || (to == ngnd))
+                    break;
+                ok = (path.count() < EXPORT_MAX_SERIES) && inSeries(to);
+                if (!ok)
+                    break;
+                t = (m_netlist[to].c1c2s[0] == t) ? m_netlist[to].c1c2s[1] : m_netlist[to].c1c2s[0];
+                from = to;
+            }
+            paths.append(path);
+        }
+        if (!ok)
+            continue;
+
+        Logic *root;
+        if ((paths.count() == 1) && (paths[0].count() == 1))
+            root = new Logic(n, LogicOp::Inverter, false);
+        else
+            root = new Logic(n, (paths.count() == 1) ? LogicOp::Nand : LogicOp::Nor, false);
+        for (int i = 0; i < paths.count(); i++)
+        {
+            const auto &path = paths[i];
+            if (paths.indexOf(path) < i) // Parallel transistors with the same gate nets
+                continue;
+            Logic *parent = root;
+            if ((path.count() > 1) && (paths.count() > 1))
+            {
+                parent = new Logic(n, LogicOp::And, false);
+                root->inputs.append(parent);
+            }
+            for (net_t g : path)
+                parent->inputs.append(new Logic(g, LogicOp::Net, false));
+        }
+        root->trans = trans;
+        gates.append(root);
+    }
+    return gates;
+}
+
+/*
+ * Returns the identifiers of the nets for the exports: the net name, with any characters that are not valid in an
+ * identifier replaced by underscores, or "n" and the net number if the net has no name, or if the name is taken
+ */
+QStringList ClassNetlist::getExportIds()
+{
+    static const QSet<QString> reserved {
+        "always", "and", "assign", "begin", "buf", "case", "default", "else", "end", "endmodule", "for", "force",
+        "function", "highz0", "highz1", "if", "initial", "inout", "input", "integer", "large", "medium", "module",
+        "nand", "nmos", "nor", "not", "or", "output", "parameter", "pull0", "pull1", "pulldown", "pullup", "reg",
+        "release", "repeat", "small", "strong0", "strong1", "supply0", "supply1", "table", "task", "time", "tran",
+        "tranif0", "tranif1", "tri", "trireg", "wait", "weak0", "weak1", "while", "wire", "xnor", "xor" };
+    QStringList ids;
+    QSet<QString> used = reserved;
+    for (net_t n = 0; n < m_netlist.count(); n++)
+    {
+        QString id = m_netnames[n];
+        for (auto &c : id)
+            if (!c.isLetterOrNumber() && (c != QLatin1Char('_')))
+                c = QLatin1Char('_');
+        if (id.isEmpty() || id[0].isDigit() || used.contains(id))
+            id.clear();
+        else
+            used.insert(id);
+        ids.append(id);
+    }
+    for (net_t n = 0; n < m_netlist.count(); n++)
+    {
+        if (ids[n].isEmpty())
+        {
+            QString id = "n" + QString::number(n);
+            while (used.contains(id))
+                id.append(QLatin1Char('_'));
+            used.insert(id);
+            ids[n] = id;
+        }
+    }
+    return ids;
+}
+
+/*
+ * Returns the net numbers of the chip pads, or an empty list if the netlist does not name them all
+ */
+QVector<net_t> ClassNetlist::getPads()
+{
+    QVector<net_t> pads;
+    for (const auto &name : padInputs + padBus("ab", 16) + padControls + padBus("db", 8))
+    {
+        if (!get(name))
+        {
+            qCritical() << "Unknown pad net name" << name;
+            return {};
+        }
+        pads.append(get(name));
+    }
+    return pads;
+}
+
+// Writes a declaration of a list of identifiers, wrapped to a reasonable line length
+static void writeList(QTextStream &out, const QString &head, const QStringList &ids)
+{
+    if (ids.isEmpty())
+        return;
+    QString line = "    " + head + " ";
+    for (int i = 0; i < ids.count(); i++)
+    {
+        const QString item = ids[i] + ((i + 1 < ids.count()) ? "," : ";");
+        if ((line.length() + item.length() > 118) && !line.endsWith(' '))
+        {
+            out << line << "\n";
+            line = "        ";
+        }
+        else if (!line.endsWith(' '))
+            line.append(' ');
+        line.append(item);
+    }
+    out << line << "\n";
+}
+
+/*
+ * Exports the netlist as a gate-level Verilog module: the static gates are continuous assignments, and the other
+ * transistors are bidirectional switches (tranif1) between the nets that store charge (trireg), the supply nets and
+ * the pull-ups. The ports are the chip pads.
+ */
+bool ClassNetlist::exportVerilog(const QString &fileName)
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const QVector<net_t> pads = getPads();
+    if (pads.isEmpty())
+        return false;
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+    {
+        qCritical() << "Error writing" << fileName;
+        return false;
+    }
+    qInfo() << "Exporting Verilog module to" << fileName;
+    QVector<bool> pad(m_netlist.count()), used(m_netlist.count()), gate(m_netlist.count()), replaced(MAX_TRANS);
+    for (net_t n : pads)
+        pad[n] = used[n] = true;
+    const QStringList ids = getExportIds();
+    const QVector<Logic *> gates = getStaticGates(pad);
+    for (const Logic *g : gates)
+    {
+        gate[g->outnet] = used[g->outnet] = true;
+        for (const Trans &t : g->trans)
+            replaced[t.id] = true;
+        std::function<void(const Logic *)> mark = [&](const Logic *p)
+        {
+            used[p->outnet] = true;
+            for (const Logic *k : p->inputs)
+                mark(k);
+        };
+        mark(g);
+    }
+    uint switches = 0;
+    for (const Trans &t : m_transdefs)
+    {
+        if (t.id && !replaced[t.id])
+        {
+            used[t.gate] = used[t.c1] = used[t.c2] = true;
+            switches++;
+        }
+    }
+
+    QTextStream out(&file);
+    out << "// Z80 chip model exported by Z80Explorer from its netlist: " << gates.count() << " static gates and " << switches << " switches\n";
+    out << "// Static gates are continuous assignments; other transistors are bidirectional switches between charge-storing nets\n\n";
+    QStringList ports;
+    for (net_t n : pads)
+        ports.append(ids[n]);
+    out << "module z80(" << ports.join(", ") << ");\n";
+    writeList(out, "input", ports.mid(0, padInputs.count()));
+    writeList(out, "output", ports.mid(padInputs.count(), 16 + padControls.count()));
+    writeList(out, "inout", ports.mid(padInputs.count() + 16 + padControls.count()));
+    out << "    supply0 " << ids[ngnd] << ";\n";
+    out << "    supply1 " << ids[npwr] << ";\n";
+    QStringList wires, triregs, pullups;
+    for (net_t n = npwr + 1; n < m_netlist.count(); n++)
+    {
+        if (!used[n] || (n == nclk) || padInputs.contains(get(n)))
+            continue;
+        if (gate[n])
+            wires.append(ids[n]);
+        else
+        {
+            triregs.append(ids[n]);
+            if (m_netlist[n].hasPullup)
+                pullups.append(ids[n]);
+        }
+    }
+    writeList(out, "wire", wires);
+    writeList(out, "trireg", triregs);
+    out << "\n    // Pull-ups\n";
+    for (const auto &id : pullups)
+        out << "    pullup (" << id << ");\n";
+    out << "\n    // Static gates\n";
+    for (const Logic *g : gates)
+        out << "    assign " << ids[g->outnet] << " = " << exportExpr(g, [&](net_t n) { return ids[n]; }, "~") << ";\n";
+    out << "\n    // Switches\n";
+    for (const Trans &t : m_transdefs)
+        if (t.id && !replaced[t.id])
+            out << "    tranif1 (" << ids[t.c1] << ", " << ids[t.c2] << ", " << ids[t.gate] << ");\n";
+    out << "endmodule\n";
+
+    for (Logic *g : gates)
+        purgeTree(g);
+    qInfo() << "Exported" << gates.count() << "static gates and" << switches << "switches in" << elapsed.elapsed() << "ms";
+    return out.status() == QTextStream::Ok;
+}
+
+// Switch-level solver and chip pins of the exported C model; the netlist tables precede it
+static const char *cModelSolver = R"(
+/* Net flags */
+#define Z80_PULLUP 1                /* Net has a pull-up */
+#define Z80_GATE   2                /* Net is the output of a static gate, see z80_gate() */
+#define Z80_FLOATS 4                /* Net is a pad that can be in hi-Z */
+
+typedef struct z80_chip
+{
+    uint8_t state[Z80_NETS];        /* Net states */
+    uint8_t high[Z80_NETS];         /* Net is pulled high: a pull-up or an input pad set to 1 */
+    uint8_t low[Z80_NETS];          /* Net is pulled low: an input pad set to 0 */
+    uint8_t on[Z80_TRANS];          /* Transistor is on */
+    uint8_t *mem;                   /* 64K of memory and IO space that z80_half_cycle() reads and writes */
+    uint8_t *io;
+    uint32_t hcycle;                /* Half-cycles since the reset */
+    uint16_t list[Z80_NETS], recalc[Z80_NETS], group[Z80_NETS];
+    int listCount, recalcCount, groupCount;
+    uint8_t inRecalc[Z80_NETS], inGroup[Z80_NETS];
+} z80_chip;
+
+static void z80_add_recalc(z80_chip *z, uint16_t n)
+{
+    if ((n <= Z80_VCC) || z->inRecalc[n])
+        return;
+    z->inRecalc[n] = 1;
+    z->recalc[z->recalcCount++] = n;
+}
+
+/* Collects the nets connected to a net through the transistors that are on; a power net goes first */
+static void z80_add_to_group(z80_chip *z, uint16_t n)
+{
+    int i;
+    if (z->inGroup[n])
+        return;
+    z->inGroup[n] = 1;
+    if (n <= Z80_VCC)
+    {
+        z->group[z->groupCount] = z->group[0];
+        z->group[0] = n;
+        z->groupCount++;
+        return;
+    }
+    z->group[z->groupCount++] = n;
+    for (i = z80_c1c2_start[n]; i < z80_c1c2_start[n + 1]; i++)
+    {
+        const uint16_t t = z80_c1c2[i];
+        uint16_t other = 0;
+        if (!z->on[t])
+            continue;
+        if (z80_trans[t][1] == n)
+            other = z80_trans[t][2];
+        if (z80_trans[t][2] == n)
+            other = z80_trans[t][1];
+        if (other)
+            z80_add_to_group(z, other);
+    }
+}
+
+/* Returns the value of a group: a power net, a pulled net, else the state of the net with the most gates */
+static int z80_group_value(const z80_chip *z)
+{
+    int i, max_state = 0, max_conn = 0;
+    if (z->group[0] <= Z80_VCC)
+        return z->group[0] == Z80_VCC;
+    for (i = 0; i < z->groupCount; i++)
+    {
+        const uint16_t n = z->group[i];
+        const int conn = z80_gates_start[n + 1] - z80_gates_start[n];
+        if (z->high[n])
+            return 1;
+        if (z->low[n])
+            return 0;
+        if (conn > max_conn)
+        {
+            max_conn = conn;
+            max_state = z->state[n];
+        }
+    }
+    return max_state;
+}
+
+static void z80_set_state(z80_chip *z, uint16_t n, int value)
+{
+    int i;
+    if (z->state[n] == value)
+        return;
+    z->state[n] = (uint8_t)value;
+    for (i = z80_gates_start[n]; i < z80_gates_start[n + 1]; i++)
+    {
+        const uint16_t t = z80_gates[i];
+        if (value && !z->on[t])
+        {
+            z->on[t] = 1;
+            z80_add_recalc(z, z80_trans[t][1]);
+        }
+        else if (!value && z->on[t])
+        {
+            z->on[t] = 0;
+            z80_add_recalc(z, z80_trans[t][1]);
+            z80_add_recalc(z, z80_trans[t][2]);
+        }
+    }
+}
+
+static void z80_recalc_net(z80_chip *z, uint16_t n)
+{
+    int i, value;
+    if (n <= Z80_VCC)
+        return;
+    if (z80_flags[n] & Z80_GATE)
+    {
+        /* A static gate is low when a path conducts, which connects it to the ground */
+        value = z80_gate(z->state, n);
+        if (!value)
+            z80_set_state(z, Z80_GND, 0);
+        z80_set_state(z, n, value);
+        return;
+    }
+    z->groupCount = 0;
+    z80_add_to_group(z, n);
+    value = z80_group_value(z);
+    for (i = 0; i < z->groupCount; i++)
+        z->inGroup[z->group[i]] = 0;
+    for (i = 0; i < z->groupCount; i++)
+        z80_set_state(z, z->group[i], value);
+}
+
+/* Recalculates the nets on the list, and the nets that they affect, wave by wave until the chip settles */
+static void z80_recalc(z80_chip *z)
+{
+    int i;
+    while (z->listCount)
+    {
+        for (i = 0; i < z->listCount; i++)
+            z80_recalc_net(z, z->list[i]);
+        for (i = 0; i < z->recalcCount; i++)
+            z->inRecalc[z->recalc[i]] = 0;
+        memcpy(z->list, z->recalc, z->recalcCount * sizeof(uint16_t));
+        z->listCount = z->recalcCount;
+        z->recalcCount = 0;
+    }
+}
+
+/* Returns the state of a net: 0, 1, or 2 for a pad in hi-Z (1 if it has a pull-up) */
+int z80_get(const z80_chip *z, uint16_t n)
+{
+    int i;
+    if (z80_flags[n] & Z80_FLOATS)
+    {
+        for (i = z80_c1c2_start[n]; i < z80_c1c2_start[n + 1]; i++)
+            if (z->on[z80_c1c2[i]])
+                return z->state[n];
+        return (z80_flags[n] & Z80_PULLUP) ? 1 : 2;
+    }
+    return z->state[n];
+}
+
+/* Drives an input pad (or any net) to a value and lets the chip settle */
+void z80_set(z80_chip *z, uint16_t n, int value)
+{
+    value = !!value;
+    if (z->high[n] == value)
+        return;
+    z->high[n] = (uint8_t)value;
+    z->low[n] = (uint8_t)!value;
+    z->list[0] = n;
+    z->listCount = 1;
+    z80_recalc(z);
+}
+
+static unsigned z80_read_bus(const z80_chip *z, const uint16_t *nets, int width)
+{
+    unsigned value = 0;
+    while (width--)
+        value = (value << 1) | !!z80_get(z, nets[width]);
+    return value;
+}
+
+static void z80_write_db(z80_chip *z, uint8_t db)
+{
+    int i;
+    for (i = 0; i < 8; i++)
+        z80_set(z, z80_db[i], (db >> i) & 1);
+}
+
+/* Runs a half-cycle: services the memory and IO cycles before the clock rise, then toggles the clock */
+void z80_half_cycle(z80_chip *z)
+{
+    const int clk = z80_get(z, Z80_NET_clk);
+    if (!clk && z80_get(z, Z80_NET__rfsh))
+    {
+        const int m1 = !!z80_get(z, Z80_NET__m1), mreq = !!z80_get(z, Z80_NET__mreq), rd = !!z80_get(z, Z80_NET__rd);
+        const int wr = !!z80_get(z, Z80_NET__wr), iorq = !!z80_get(z, Z80_NET__iorq);
+        const int t2 = !!z80_get(z, Z80_NET_t2), t3 = !!z80_get(z, Z80_NET_t3);
+        const uint16_t ab = (uint16_t)z80_read_bus(z, z80_ab, 16);
+        if (!m1 && !mreq && !rd && wr && iorq && t2)
+            z80_write_db(z, z->mem[ab]); /* Instruction read */
+        else if (m1 && !mreq && !rd && wr && iorq && t3)
+            z80_write_db(z, z->mem[ab]); /* Data read */
+        else if (m1 && !mreq && rd && !wr && iorq && t3)
+            z->mem[ab] = (uint8_t)z80_read_bus(z, z80_db, 8); /* Data write */
+        else if (m1 && mreq && !rd && wr && !iorq && t3)
+            z80_write_db(z, z->io[ab]); /* IO read */
+        else if (m1 && mreq && rd && !wr && !iorq && t3)
+            z->io[ab] = (uint8_t)z80_read_bus(z, z80_db, 8); /* IO write */
+        else if (!m1 && mreq && rd && wr && !iorq)
+            z80_write_db(z, z->io[0x81]); /* Interrupt acknowledge: IO address 0x81 holds the value on the bus */
+    }
+    z80_set(z, Z80_NET_clk, !clk);
+    z->hcycle++;
+}
+
+/* Initializes the chip: all transistors are off and the pulled-up nets are high */
+void z80_init(z80_chip *z, uint8_t *mem, uint8_t *io)
+{
+    int n;
+    memset(z, 0, sizeof(*z));
+    z->mem = mem;
+    z->io = io;
+    for (n = 0; n < Z80_NETS; n++)
+        z->high[n] = z80_flags[n] & Z80_PULLUP;
+    z->state[Z80_VCC] = 1;
+}
+
+/* Resets the chip: sets the input pads, settles all nets and runs the reset sequence */
+void z80_reset(z80_chip *z)
+{
+    int n;
+    z80_set(z, Z80_NET__reset, 0);
+    z80_set(z, Z80_NET_clk, 1);
+    z80_set(z, Z80_NET__busrq, 1);
+    z80_set(z, Z80_NET__int, 1);
+    z80_set(z, Z80_NET__nmi, 1);
+    z80_set(z, Z80_NET__wait, 1);
+    z->listCount = 0;
+    for (n = Z80_VCC + 1; n < Z80_NETS; n++)
+        if ((z80_gates_start[n] != z80_gates_start[n + 1]) || (z80_c1c2_start[n] != z80_c1c2_start[n + 1]))
+            z->list[z->listCount++] = (uint16_t)n;
+    z80_recalc(z);
+    z->hcycle = 0;
+    for (n = 0; n < 8; n++)
+        z80_half_cycle(z);
+    z80_set(z, Z80_NET__reset, 1);
+}
+)";
+
+// Writes a C array of numbers, wrapped to a reasonable line length
+template <typename T>
+static void writeArray(QTextStream &out, const QString &decl, const QVector<T> &values)
+{
+    out << "static const " << decl << " = {";
+    for (int i = 0; i < values.count(); i++)
+        out << ((i % 20) ? " " : "\n    ") << values[i] << ((i + 1 < values.count()) ? "," : "");
+    out << "\n};\n";
+}
+
+/*
+ * Exports the netlist as a standalone C model: the netlist tables, a function that evaluates the static gates and the
+ * switch-level solver of the reference simulator, which the static gates bypass. It needs only the C standard library;
+ * its functions z80_init(), z80_reset(), z80_half_cycle(), z80_set() and z80_get() run the chip. The memory and IO
+ * cycles are served as the simulator serves them, but without the trickbox.
+ */
+bool ClassNetlist::exportC(const QString &fileName)
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const QVector<net_t> pads = getPads();
+    if (pads.isEmpty() || !get("t2") || !get("t3"))
+        return false;
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+    {
+        qCritical() << "Error writing" << fileName;
+        return false;
+    }
+    qInfo() << "Exporting C model to" << fileName;
+    QVector<bool> pad(m_netlist.count());
+    for (net_t n : pads)
+        pad[n] = true;
+    const QStringList ids = getExportIds();
+    const QVector<Logic *> gates = getStaticGates(pad);
+
+    // Transistors are numbered in their order in the netlist; the adjacency keeps the order of the nets' lists,
+    // which decides the order of a group and so the net that a floating group takes its value from
+    QVector<int> index(MAX_TRANS, -1);
+    QVector<uint> trans;
+    for (const Trans &t : m_transdefs)
+    {
+        if (t.id)
+        {
+            index[t.id] = trans.count() / 3;
+            trans << t.gate << t.c1 << t.c2;
+        }
+    }
+    QVector<uint> c1c2Start, c1c2, gatesStart, gatesList, flags(m_netlist.count());
+    for (const Net &net : m_netlist)
+    {
+        c1c2Start.append(c1c2.count());
+        for (const Trans *t : net.c1c2s)
+            c1c2.append(index[t->id]);
+        gatesStart.append(gatesList.count());
+        for (const Trans *t : net.gates)
+            gatesList.append(index[t->id]);
+    }
+    c1c2Start.append(c1c2.count());
+    gatesStart.append(gatesList.count());
+    for (net_t n = 0; n < m_netlist.count(); n++)
+        flags[n] = m_netlist[n].hasPullup ? 1 : 0;
+    for (const Logic *g : gates)
+        flags[g->outnet] |= 2;
+    for (const auto &name : padFloats + padBus("ab", 16))
+        flags[get(name)] |= 4;
+
+    QTextStream out(&file);
+    out << "/*\n * Z80 chip model exported by Z80Explorer from its netlist: " << trans.count() / 3 << " transistors, "
+        << gates.count() << " of them\n * outputs of static gates that are evaluated as boolean expressions\n */\n";
+    out << "#include <stdint.h>\n#include <string.h>\n\n";
+    out << "#define Z80_NETS  " << m_netlist.count() << "\n";
+    out << "#define Z80_TRANS " << trans.count() / 3 << "\n";
+    out << "#define Z80_GND   " << ngnd << "\n";
+    out << "#define Z80_VCC   " << npwr << "\n\n";
+    out << "/* Named nets */\n";
+    for (net_t n = 0; n < m_netlist.count(); n++)
+        if (!m_netnames[n].isEmpty())
+            out << "#define Z80_NET_" << ids[n] << " " << n << "\n";
+    out << "\n/* Transistors: gate, c1, c2 */\n";
+    out << "static const uint16_t z80_trans[Z80_TRANS][3] = {";
+    for (int i = 0; i < trans.count(); i += 3)
+        out << ((i % 30) ? " " : "\n    ") << "{" << trans[i] << "," << trans[i + 1] << "," << trans[i + 2] << "}" << ((i + 3 < trans.count()) ? "," : "");
+    out << "\n};\n";
+    out << "/* Transistors that connect to each net, and that each net is the gate of */\n";
+    writeArray(out, "uint16_t z80_c1c2_start[Z80_NETS + 1]", c1c2Start);
+    writeArray(out, "uint16_t z80_c1c2[]", c1c2);
+    writeArray(out, "uint16_t z80_gates_start[Z80_NETS + 1]", gatesStart);
+    writeArray(out, "uint16_t z80_gates[]", gatesList);
+    writeArray(out, "uint8_t z80_flags[Z80_NETS]", flags);
+    QVector<uint> ab, db;
+    for (const auto &name : padBus("ab", 16))
+        ab.append(get(name));
+    for (const auto &name : padBus("db", 8))
+        db.append(get(name));
+    writeArray(out, "uint16_t z80_ab[16]", ab);
+    writeArray(out, "uint16_t z80_db[8]", db);
+
+    out << "\n/* Static gates: returns the value of a gate output from the states of its inputs */\n";
+    out << "static int z80_gate(const uint8_t *s, uint16_t n)\n{\n    switch (n)\n    {\n";
+    for (const Logic *g : gates)
+        out << "    case " << g->outnet << ": return " << exportExpr(g, [](net_t n) { return QString("s[%1]").arg(n); }, "!")
+            << "; /* " << ids[g->outnet] << " */\n";
+    out << "    }\n    return 0;\n}\n";
+    out << cModelSolver;
+
+    for (Logic *g : gates)
+        purgeTree(g);
+    qInfo() << "Exported" << trans.count() / 3 << "transistors and" << gates.count() << "static gates in" << elapsed.elapsed() << "ms";
+    return out.status() == QTextStream::Ok;
+}
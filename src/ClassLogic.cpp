@@ -440,6 +440,7 @@ Logic *ClassNetlist::parse(Logic *node, int depth)
             //-------------------------------------------------------------------------------
             // Detect if a net is a part of a latch
             //-------------------------------------------------------------------------------
+#if !HEADLESS_CLI // Latches are defined with the chip layout, which the command-line runner does not load
             latchdef *latch = ::controller.getChip().getLatch(t1.id);
             if (latch != nullptr)
             {
@@ -455,6 +456,7 @@ Logic *ClassNetlist::parse(Logic *node, int depth)
                 root->trans.removeFirst();
                 continue;
             }
+#endif // HEADLESS_CLI
 
             //-------------------------------------------------------------------------------
             // Complex NAND gate extends through 2 pass-transistor nets (ex. net 215)
@@ -82,6 +82,8 @@ public:
     Logic* getLogicTree(net_t net);             // Returns a tree describing the logic connections of a net
     void optimizeLogicTree(Logic **ppl);        // Optimizes, in place, logic tree by coalescing suitable nodes
     QString equation(net_t net);                // Returns a string describing the logic connections of a net
+    bool exportVerilog(const QString &fileName); // Exports the chip model as a gate-level Verilog module
+    bool exportC(const QString &fileName);      // Exports the chip model as a standalone C model
 
     // Net value reads exposed for scripting and instrumentation
     uint8_t readByte(const QString &name);      // Returns a byte value read from the netlist for a particular net bus
@@ -103,6 +105,11 @@ private:
     bool loadPullups(const QString dir);
     bool saveNetNames(const QString fileName);
 
+    // Exports the chip model (see ClassExport.cpp)
+    QVector<Logic *> getStaticGates(const QVector<bool> &pad); // Returns the logic trees of the static gates
+    QStringList getExportIds();                 // Returns the net identifiers for the exports
+    QVector<net_t> getPads();                   // Returns the nets of the chip pads, in the order of the module ports
+
     // The lookup between net names and their numbers is performance critical, so we keep two ways to access them:
     QString m_netnames[MAX_NETS] {};            // List of net names, directly indexed by the net number
     QHash<QString, net_t> m_netnums {};         // Hash of net names to their net numbers; key is the net name string
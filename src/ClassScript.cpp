@@ -19,11 +19,21 @@ void ClassScript::init(QJSEngine *sc)
     m_engine->globalObject().setProperty("run", ext.property("run"));
     m_engine->globalObject().setProperty("stop", ext.property("stop"));
     m_engine->globalObject().setProperty("reset", ext.property("reset"));
+    m_engine->globalObject().setProperty("rewind", ext.property("rewind"));
+    m_engine->globalObject().setProperty("fastForward", ext.property("fastForward"));
+    m_engine->globalObject().setProperty("lockstep", ext.property("lockstep"));
+    m_engine->globalObject().setProperty("saveState", ext.property("saveState"));
+    m_engine->globalObject().setProperty("loadState", ext.property("loadState"));
     m_engine->globalObject().setProperty("t", ext.property("t"));
     m_engine->globalObject().setProperty("n", ext.property("n"));
     m_engine->globalObject().setProperty("eq", ext.property("eq"));
+    m_engine->globalObject().setProperty("exportVerilog", ext.property("exportVerilog"));
+    m_engine->globalObject().setProperty("exportC", ext.property("exportC"));
     m_engine->globalObject().setProperty("print", ext.property("print"));
     m_engine->globalObject().setProperty("relatch", ext.property("relatch"));
+    m_engine->globalObject().setProperty("stats", ext.property("stats"));
+    m_engine->globalObject().setProperty("perf", ext.property("perf"));
+    m_engine->globalObject().setProperty("perfCounters", ext.property("perfCounters"));
     m_engine->globalObject().setProperty("save", ext.property("save"));
     m_engine->globalObject().setProperty("ex", ext.property("ex"));
     m_engine->globalObject().setProperty("execApp", ext.property("execApp"));
@@ -95,6 +105,31 @@ void ClassScript::reset()
     ::controller.doReset();
 }
 
+void ClassScript::rewind(uint hcycle)
+{
+    ::controller.doRewind(hcycle);
+}
+
+bool ClassScript::fastForward(uint hcycles, int pc)
+{
+    return ::controller.doFastForward(hcycles, pc);
+}
+
+bool ClassScript::lockstep(uint hcycles, uint every)
+{
+    return ::controller.doLockstep(hcycles, every);
+}
+
+bool ClassScript::saveState(QString fileName)
+{
+    return ::controller.saveState(fileName);
+}
+
+bool ClassScript::loadState(QString fileName)
+{
+    return ::controller.loadState(fileName);
+}
+
 void ClassScript::t(uint n)
 {
     QString s = ::controller.getNetlist().transInfo(n);
@@ -129,6 +164,77 @@ void ClassScript::eq(QVariant n)
     emit ::controller.getScript().print(s);
 }
 
+bool ClassScript::exportVerilog(QString fileName)
+{
+    return ::controller.getNetlist().exportVerilog(fileName);
+}
+
+bool ClassScript::exportC(QString fileName)
+{
+    return ::controller.getNetlist().exportC(fileName);
+}
+
+/*
+ * Prints the simulator statistics since the last reset
+ */
+void ClassScript::stats()
+{
+#if USE_AVX2_SIM
+    auto &sim = ::controller.getSimZ80();
+    const quint64 hits = sim.getGroupCacheHits(), misses = sim.getGroupCacheMisses();
+    const double rate = (hits + misses) ? 100.0 * hits / (hits + misses) : 0.0;
+    emit ::controller.getScript().print(QString("Group cache: %1 hits, %2 misses (%3% hit rate)").arg(hits).arg(misses).arg(rate, 0, 'f', 1));
+    emit ::controller.getScript().print(QString("Bit slices: %1 classes of %2 isomorphic components share the group cache").arg(sim.getSliceClasses()).arg(sim.getSliceComponents()));
+    emit ::controller.getScript().print(QString("Steady-state loops: %1 half-cycles skipped").arg(sim.getHCyclesSkipped()));
+    emit ::controller.getScript().print(QString("Static gates: %1 boolean nodes, %2 evaluations").arg(sim.getGateCount()).arg(sim.getGateEvals()));
+    emit ::controller.getScript().print(QString("Incremental groups: %1 net evaluations reused a valid group").arg(sim.getGroupReuses()));
+    emit ::controller.getScript().print(QString("Wave deduplication: %1 net evaluations skipped, their group was resolved in the same wave").arg(sim.getWaveDedups()));
+#else
+    emit ::controller.getScript().print("Statistics are available only with the optimized simulator");
+#endif
+}
+
+/*
+ * Prints the simulator performance counters since the last reset
+ */
+void ClassScript::perf()
+{
+#if USE_AVX2_SIM
+    emit ::controller.getScript().print(::controller.getSimZ80().getPerfCounters().toString());
+#else
+    emit ::controller.getScript().print("Performance counters are available only with the optimized simulator");
+#endif
+}
+
+/*
+ * Returns the simulator performance counters since the last reset as an object, for the scripts to read
+ * All counters are zero unless the app was built with the performance counters
+ */
+QJSValue ClassScript::perfCounters()
+{
+    QJSValue result = m_engine->newObject();
+#if USE_AVX2_SIM
+    const SimPerfCounters &c = ::controller.getSimZ80().getPerfCounters();
+    result.setProperty("enabled", bool(SIM_PERF_COUNTERS));
+    result.setProperty("netlistRecalcs", double(c.netlistRecalcs));
+    result.setProperty("waves", double(c.waves));
+    result.setProperty("maxWaves", double(c.maxWaves));
+    result.setProperty("netRecalcs", double(c.netRecalcs));
+    result.setProperty("groupVisits", double(c.groupVisits));
+    QJSValue sizes = m_engine->newArray(PERF_GROUP_BINS);
+    for (uint i = 0; i < PERF_GROUP_BINS; i++)
+        sizes.setProperty(i, double(c.groupSizes[i]));
+    result.setProperty("groupSizes", sizes);
+    result.setProperty("setDBRecalcs", double(c.setDBRecalcs));
+    result.setProperty("halfCycles", double(c.halfCycles));
+    result.setProperty("halfCycleNs", double(c.halfCycleNs));
+    result.setProperty("maxHalfCycleNs", double(c.maxHalfCycleNs));
+#else
+    result.setProperty("enabled", false);
+#endif
+    return result;
+}
+
 /*
  * Rebuilds latches; reloads custom latches
  */
@@ -26,11 +26,21 @@ public:
     Q_INVOKABLE void run(uint hcycles);
     Q_INVOKABLE void stop();
     Q_INVOKABLE void reset();
+    Q_INVOKABLE void rewind(uint hcycle);
+    Q_INVOKABLE bool fastForward(uint hcycles, int pc = -1);
+    Q_INVOKABLE bool lockstep(uint hcycles, uint every = 1);
+    Q_INVOKABLE bool saveState(QString fileName);
+    Q_INVOKABLE bool loadState(QString fileName);
     Q_INVOKABLE void t(uint n);
     Q_INVOKABLE void n(QVariant net);
     Q_INVOKABLE void eq(QVariant n);
+    Q_INVOKABLE bool exportVerilog(QString fileName);
+    Q_INVOKABLE bool exportC(QString fileName);
     Q_INVOKABLE void relatch();
     Q_INVOKABLE void ex(uint n);
+    Q_INVOKABLE void stats();
+    Q_INVOKABLE void perf();
+    Q_INVOKABLE QJSValue perfCounters();
     Q_INVOKABLE QJSValue execApp(const QString &path, const QStringList &args, bool synchronous = true);
 
     // Net value reads for instrumentation scripts
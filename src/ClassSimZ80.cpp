@@ -82,16 +82,34 @@ void ClassSimZ80::onTimeout()
  */
 bool ClassSimZ80::setPin(uint index, pin_t p)
 {
-    const static QStringList pins = { "_int", "_nmi", "_busrq", "_wait", "_reset" };
-    if (index < uint(pins.count()))
-    {
-        set(p, pins[index]);
+    if ((index < 32) && setPins(1u << index, uint(p != 0) << index))
         return true;
-    }
     Q_ASSERT(0);
     return false;
 }
 
+/*
+ * Sets the input pins selected by the mask (bit 0 is "_int") to the values of their bits, settling them together
+ * Returns false if the mask selects an undefined input pin
+ */
+bool ClassSimZ80::setPins(uint mask, uint values)
+{
+    const static QStringList pins = { "_int", "_nmi", "_busrq", "_wait", "_reset" };
+    if (mask >> pins.count())
+        return false;
+    net_t nets[5];
+    uint bits = 0, count = 0;
+    for (int i = 0; i < pins.count(); i++)
+    {
+        if (!((mask >> i) & 1))
+            continue;
+        nets[count] = get(pins[i]);
+        bits |= ((values >> i) & 1) << count++;
+    }
+    set(nets, bits, count);
+    return true;
+}
+
 /*
  * Run the simulation for the given number of clocks. Zero stops the simulation.
  */
@@ -167,6 +185,34 @@ uint ClassSimZ80::doReset()
     return m_hcycletotal;
 }
 
+/*
+ * Sets the states of all nets (bit 0 is the state, bit 1 pulled high, bit 2 pulled low) and transistors, and the
+ * half-cycle count, so that this simulator continues from the state of another one (see stepFollower())
+ */
+void ClassSimZ80::setNetStates(const uint8_t *nets, const uint8_t *trans, uint hcycle)
+{
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        m_netlist[n].state = nets[n] & 1;
+        m_netlist[n].isHigh = nets[n] & 2;
+        m_netlist[n].isLow = nets[n] & 4;
+    }
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+        m_transdefs[t].on = trans[t];
+    m_hcycletotal = hcycle;
+}
+
+/*
+ * Runs one half-cycle as the follower of another simulator that runs the same program in lockstep with it
+ * It reads the memory and IO like the leader, which does the writes, the watch and the app ticks for both
+ */
+void ClassSimZ80::stepFollower()
+{
+    m_follower = true;
+    halfCycle();
+    m_follower = false;
+}
+
 /*
  * Advance the simulation by one half-cycle of the clock
  */
@@ -205,6 +251,12 @@ inline void ClassSimZ80::halfCycle()
 
     set(!clk, "clk"); // Let the clock edge propagate through the chip
 
+    if (m_follower) // The leading simulator populates the watch data and informs the app
+    {
+        m_hcycletotal.fetchAndAddRelaxed(1);
+        return;
+    }
+
     // After each half-cycle, populate the watch data
     if (::controller.getWatch().getWatchlistLen()) // Removing all watches increases the performance
     {
@@ -234,6 +286,8 @@ inline void ClassSimZ80::handleMemRead(uint16_t ab)
 
 inline void ClassSimZ80::handleMemWrite(uint16_t ab)
 {
+    if (m_follower) // The leading simulator writes the same data
+        return;
     uint8_t db = readByte("db");
     ::controller.writeMem(ab, db);
 }
@@ -246,6 +300,8 @@ inline void ClassSimZ80::handleIORead(uint16_t ab)
 
 inline void ClassSimZ80::handleIOWrite(uint16_t ab)
 {
+    if (m_follower)
+        return;
     uint8_t db = readByte("db");
     ::controller.writeIO(ab, db);
 }
@@ -257,16 +313,15 @@ inline void ClassSimZ80::handleIrq()
     setDB(db);
 }
 
+/*
+ * Sets the data bus to a value; the eight bits settle together, the way a memory drives them
+ */
 inline void ClassSimZ80::setDB(uint8_t db)
 {
-    set(db &   1, "db0");
-    set(db &   2, "db1");
-    set(db &   4, "db2");
-    set(db &   8, "db3");
-    set(db &  16, "db4");
-    set(db &  32, "db5");
-    set(db &  64, "db6");
-    set(db & 128, "db7");
+    net_t nets[8];
+    for (int i = 0; i < 8; i++)
+        nets[i] = get(QString("db%1").arg(i));
+    set(nets, db, 8);
 }
 
 /*
@@ -274,18 +329,40 @@ inline void ClassSimZ80::setDB(uint8_t db)
  */
 inline void ClassSimZ80::set(bool on, QString name)
 {
-    net_t n = get(name);
-    if (m_netlist[n].isHigh == on) // The state did not change
-        return;
-    m_netlist[n].isHigh = on;
-    m_netlist[n].isLow = !on;
+    const net_t n = get(name);
+    set(&n, on, 1);
+}
+
+/*
+ * Sets input nets to pullup or pulldown status, bit i of the values for nets[i], and recalculates the netlist once for
+ * those that changed, which all start its first wave. The nets must be distinct.
+ */
+void ClassSimZ80::set(const net_t *nets, uint values, uint count)
+{
+#if !USE_PERFORMANCE_SIM
+    QVector<net_t> list;
+#else
+    m_listIndex = 0;
+#endif
+    for (uint i = 0; i < count; i++)
+    {
+        const bool on = (values >> i) & 1;
+        if (m_netlist[nets[i]].isHigh == on) // The state did not change
+            continue;
+        m_netlist[nets[i]].isHigh = on;
+        m_netlist[nets[i]].isLow = !on;
 #if USE_PERFORMANCE_SIM
-    m_list[0] = n;
-    m_listIndex = 1;
-    recalcNetlist();
+        m_list[m_listIndex++] = nets[i];
 #else
-    QVector<net_t> list {n};
-    recalcNetlist(list);
+        list.append(nets[i]);
+#endif
+    }
+#if USE_PERFORMANCE_SIM
+    if (m_listIndex)
+        recalcNetlist();
+#else
+    if (!list.isEmpty())
+        recalcNetlist(list);
 #endif
 }
 
@@ -301,7 +378,7 @@ inline bool ClassSimZ80::getNetValue()
         Net &net = m_netlist[m_group[0]];
         if (Q_UNLIKELY(net.isHigh)) return true;
         if (Q_UNLIKELY(net.isLow)) return false;
-        return net.state;
+        return net.state && net.gates.count(); // Like the general case, a floating net without gates resolves low
     }
 
     // General case: single pass — pullups/pulldowns get immediate exit (rare);
@@ -371,6 +448,7 @@ inline void ClassSimZ80::recalcNetlist()
 
     while (m_listIndex)
     {
+        m_netsRecalculated += m_listIndex;
         for (int i = 0; i < m_listIndex; i++)
             recalcNet(m_list[i]);
         memcpy(m_list, m_recalcList, m_recalcListIndex * sizeof(net_t));
@@ -385,6 +463,7 @@ inline void ClassSimZ80::recalcNetlist(QVector<net_t> &list)
     recalcList.clear();
     for (int i = 0; (i < 100) && list.count(); i++) // loop limiter
     {
+        m_netsRecalculated += list.count();
         for (auto n : list)
             recalcNet(n);
         list = recalcList;
@@ -20,11 +20,15 @@ public:
     uint doReset();                     // Run chip reset sequence
     void doRunsim(uint ticks);          // Run the simulation for the given number of clocks
     bool setPin(uint index, pin_t p);   // Sets an input pin to a value
+    bool setPins(uint mask, uint values); // Sets the input pins selected by the mask (bit index) together
     bool isRunning() { return m_runcount; }; // Returns true if the simulation is currently running
     uint16_t getPC()                    // Returns the current value of the PC register
         { return (readByte("reg_pch") << 8) | readByte("reg_pcl"); }
     uint getCurrentHCycle() { return m_hcycletotal; }
     uint getEstHz() { return m_estHz; }
+    quint64 getNetsRecalculated() { return m_netsRecalculated; } // Returns the number of nets evaluated since the load
+    void setNetStates(const uint8_t *nets, const uint8_t *trans, uint hcycle); // Sets the states of all nets and transistors
+    void stepFollower();                // Runs one half-cycle in lockstep behind another simulator
 
 public slots:
     void onShutdown()                   // Called when the app is closing
@@ -42,6 +46,7 @@ private:
 
     void setDB(uint8_t db);             // Sets data bus to a value
     void set(bool on, QString name);    // Sets a named input net to pullup or pulldown status
+    void set(const net_t *nets, uint values, uint count); // Sets input nets together; bit i of the values is nets[i]
 
     //----------------------- Simulator ------------------------
     void halfCycle();
@@ -93,6 +98,8 @@ private:
     QAtomicInt m_runcount {};           // Simulation thread down-counts this to exit
     QAtomicInt m_hcyclecnt {};          // Simulation half-cycle count (resets on each runstart event)
     QAtomicInt m_hcycletotal {};        // Total simulation half-cycle count (resets on a chip reset)
+    quint64 m_netsRecalculated {};      // Number of nets evaluated, counted by the recalculation waves
+    bool m_follower {};                 // Lockstep follower: reads the buses, but leaves the writes and ticks to the leader
 };
 
 #endif // CLASSSIMZ80_H
@@ -1,25 +1,68 @@
 #include "ClassSimZ80_AVX2.h"
 #include "ClassController.h"
+#include "ClassSimZ80.h"
+#include <QDataStream>
 #include <QFile>
 #include <QStringBuilder>
 #include <QtConcurrent>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#endif
+
+//=============================================================================
+// PORTABLE ALIGNED ALLOCATION
+//=============================================================================
+
+static void *alignedAlloc(size_t size, size_t alignment)
+{
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+#else
+    // aligned_alloc() requires the size to be a multiple of the alignment
+    return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+}
+
+static void alignedFree(void *p)
+{
+#if defined(_MSC_VER)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
 
 ClassSimZ80_AVX2::ClassSimZ80_AVX2()
     : m_gatesPool(nullptr)
-    , m_c1c2sPool(nullptr)
+    , m_adjPool(nullptr)
     , m_gatesPoolSize(0)
-    , m_c1c2sPoolSize(0)
+    , m_adjPoolSize(0)
     , m_listIndex(0)
     , m_recalcListIndex(0)
     , m_groupIndex(0)
+    , m_cccCount(0)
+    , m_groupCache(nullptr)
+    , m_groupCacheHits(0)
+    , m_groupCacheMisses(0)
+    , m_waveStamp(0)
     , ngnd(0)
     , npwr(0)
     , nclk(0)
 {
     connect(&m_timer, &QTimer::timeout, this, &ClassSimZ80_AVX2::onTimeout);
 
+    static_assert(sizeof(GroupCacheEntry) == CACHE_LINE_SIZE, "group cache entry should fill one cache line");
+
     // Zero-initialize all arrays
     memset(m_transOn, 0, sizeof(m_transOn));
+    memset(m_netState, 0, sizeof(m_netState));
+    memset(m_netHigh, 0, sizeof(m_netHigh));
+    memset(m_netLow, 0, sizeof(m_netLow));
     memset(m_transC1, 0, sizeof(m_transC1));
     memset(m_transC2, 0, sizeof(m_transC2));
     memset(m_transGate, 0, sizeof(m_transGate));
@@ -29,15 +72,38 @@ ClassSimZ80_AVX2::ClassSimZ80_AVX2()
     memset(m_group, 0, sizeof(m_group));
     memset(m_groupBitset, 0, sizeof(m_groupBitset));
     memset(m_recalcBitset, 0, sizeof(m_recalcBitset));
+    memset(m_cccWordMask, 0, sizeof(m_cccWordMask));
+    memset(m_cccOn, 0, sizeof(m_cccOn));
+    memset(m_cccPull, 0, sizeof(m_cccPull));
+    memset(m_cccGen, 0, sizeof(m_cccGen));
+    memset(m_netGen, 0xFF, sizeof(m_netGen));
+    memset(m_netPowerGen, 0, sizeof(m_netPowerGen));
+    memset(m_waveNets, 0, sizeof(m_waveNets));
+    memset(m_waveResolved, 0, sizeof(m_waveResolved));
+    memset(m_netWaveGen, 0, sizeof(m_netWaveGen));
+    memset(m_transCccBit, 0, sizeof(m_transCccBit));
+    memset(m_transCcc, 0, sizeof(m_transCcc));
+    memset(m_netPullShift, 0, sizeof(m_netPullShift));
+    memset(m_netCacheKey, 0, sizeof(m_netCacheKey));
+    memset(m_cccNetStart, 0, sizeof(m_cccNetStart));
+    memset(m_cccConflictStart, 0, sizeof(m_cccConflictStart));
+    memset(m_cccStamp, 0, sizeof(m_cccStamp));
+
+    selectKernels(detectIsa());
 }
 
 ClassSimZ80_AVX2::~ClassSimZ80_AVX2()
 {
+    stopWorkers();
+    delete m_trace;
+
     // Free memory pools
     if (m_gatesPool)
-        _aligned_free(m_gatesPool);
-    if (m_c1c2sPool)
-        _aligned_free(m_c1c2sPool);
+        alignedFree(m_gatesPool);
+    if (m_adjPool)
+        alignedFree(m_adjPool);
+    if (m_groupCache)
+        alignedFree(m_groupCache);
 }
 
 void ClassSimZ80_AVX2::onShutdown()
@@ -46,42 +112,195 @@ void ClassSimZ80_AVX2::onShutdown()
 }
 
 //=============================================================================
-// AVX2 OPTIMIZED BITSET OPERATIONS
+// SIMD KERNELS AND RUNTIME DISPATCH
 //=============================================================================
 
-// Clear 512 bytes (64 uint64_t) using AVX2
+// Each kernel clears 512 bytes (64 uint64_t) of a cache-line aligned bitset
+static void clearBitset_Scalar(uint64_t* bitset)
+{
+    memset(bitset, 0, 64 * sizeof(uint64_t));
+}
+
+#if SIM_X86
+// 32 stores of 16 bytes each
+SIM_TARGET("sse2") static void clearBitset_SSE2(uint64_t* bitset)
+{
+    __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < 64; i += 2)
+        _mm_store_si128(reinterpret_cast<__m128i*>(bitset + i), zero);
+}
+
 // 16 stores of 32 bytes each
-__forceinline void ClassSimZ80_AVX2::clearBitset_AVX2(uint64_t* bitset)
+SIM_TARGET("avx2") static void clearBitset_AVX2(uint64_t* bitset)
 {
     __m256i zero = _mm256_setzero_si256();
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 0), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 4), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 8), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 12), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 16), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 20), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 24), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 28), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 32), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 36), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 40), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 44), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 48), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 52), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 56), zero);
-    _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + 60), zero);
+    for (int i = 0; i < 64; i += 4)
+        _mm256_store_si256(reinterpret_cast<__m256i*>(bitset + i), zero);
+}
+
+// 8 stores of 64 bytes each
+SIM_TARGET("avx512f") static void clearBitset_AVX512(uint64_t* bitset)
+{
+    __m512i zero = _mm512_setzero_si512();
+    for (int i = 0; i < 64; i += 8)
+        _mm512_store_si512(reinterpret_cast<__m512i*>(bitset + i), zero);
+}
+#endif
+
+/*
+ * Each kernel tests up to 64 edges of an adjacency row and returns a bit per edge whose transistor is on and whose
+ * other net is not in the visited bitset. The SIMD kernels load the edges as 32-bit lanes (transistor in the low half,
+ * other net in the high half) and gather the 32-bit words of both bitsets that hold their bits.
+ */
+static uint64_t edgeMask_Scalar(const NetEdge* row, int count, const uint64_t* transOn, const uint64_t* visited)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const uint64_t on = transOn[row[i].t >> 6] >> (row[i].t & 63);
+        const uint64_t seen = visited[row[i].other >> 6] >> (row[i].other & 63);
+        mask |= ((on & ~seen) & 1) << i;
+    }
+    return mask;
+}
+
+// The scalar kernel for the parallel workers: another worker may update the words of the transistor bitset at the same
+// time (other bits of them), and the vector gathers have no atomic form, so each word is read with an atomic load
+static uint64_t edgeMask_Relaxed(const NetEdge* row, int count, const uint64_t* transOn, const uint64_t* visited)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const uint64_t on = simAtomicLoad64(&transOn[row[i].t >> 6]) >> (row[i].t & 63);
+        const uint64_t seen = visited[row[i].other >> 6] >> (row[i].other & 63);
+        mask |= ((on & ~seen) & 1) << i;
+    }
+    return mask;
 }
 
-// Test bit using x64 BT instruction
-__forceinline bool ClassSimZ80_AVX2::testBit(const uint64_t* bitset, net_t n)
+#if SIM_X86
+// 8 edges per step; the lanes past the end of the row load as zero (transistor 0, net 0) and are masked out
+SIM_TARGET("avx2") static uint64_t edgeMask_AVX2(const NetEdge* row, int count, const uint64_t* transOn, const uint64_t* visited)
 {
-    return _bittest64(reinterpret_cast<const __int64*>(bitset), n);
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+    const __m256i low5 = _mm256_set1_epi32(31);
+    const __m256i one = _mm256_set1_epi32(1);
+    uint64_t mask = 0;
+    for (int i = 0; i < count; i += 8)
+    {
+        const __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - i), laneIndex);
+        const __m256i e = _mm256_maskload_epi32(reinterpret_cast<const int*>(row + i), valid);
+        const __m256i t = _mm256_and_si256(e, low16);
+        const __m256i other = _mm256_srli_epi32(e, 16);
+        __m256i on = _mm256_i32gather_epi32(reinterpret_cast<const int*>(transOn), _mm256_srli_epi32(t, 5), 4);
+        on = _mm256_srlv_epi32(on, _mm256_and_si256(t, low5));
+        __m256i seen = _mm256_i32gather_epi32(reinterpret_cast<const int*>(visited), _mm256_srli_epi32(other, 5), 4);
+        seen = _mm256_srlv_epi32(seen, _mm256_and_si256(other, low5));
+        const __m256i bit = _mm256_and_si256(_mm256_andnot_si256(seen, on), one);
+        const __m256i take = _mm256_and_si256(_mm256_cmpeq_epi32(bit, one), valid);
+        mask |= uint64_t(uint(_mm256_movemask_ps(_mm256_castsi256_ps(take)))) << i;
+    }
+    return mask;
+}
+
+// 16 edges per step; the opmask for the end of the row also zeroes the lanes past it
+SIM_TARGET("avx512f") static uint64_t edgeMask_AVX512(const NetEdge* row, int count, const uint64_t* transOn, const uint64_t* visited)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i low16 = _mm512_set1_epi32(0xFFFF);
+    const __m512i low5 = _mm512_set1_epi32(31);
+    const __m512i one = _mm512_set1_epi32(1);
+    uint64_t mask = 0;
+    for (int i = 0; i < count; i += 16)
+    {
+        const __mmask16 valid = __mmask16((count - i >= 16) ? 0xFFFF : ((1u << (count - i)) - 1));
+        const __m512i e = _mm512_maskz_loadu_epi32(valid, row + i);
+        const __m512i t = _mm512_and_si512(e, low16);
+        const __m512i other = _mm512_maskz_srli_epi32(valid, e, 16);
+        __m512i on = _mm512_mask_i32gather_epi32(zero, valid, _mm512_maskz_srli_epi32(valid, t, 5), transOn, 4);
+        on = _mm512_maskz_srlv_epi32(valid, on, _mm512_and_si512(t, low5));
+        __m512i seen = _mm512_mask_i32gather_epi32(zero, valid, _mm512_maskz_srli_epi32(valid, other, 5), visited, 4);
+        seen = _mm512_maskz_srlv_epi32(valid, seen, _mm512_and_si512(other, low5));
+        mask |= uint64_t(_mm512_mask_test_epi32_mask(valid, _mm512_maskz_andnot_epi32(valid, seen, on), one)) << i;
+    }
+    return mask;
+}
+#endif
+
+/*
+ * Returns the best instruction set level that both the CPU and the OS (saved register state) support
+ * Environment variable Z80_SIM_ISA (scalar, sse2, avx2, avx512) can lower the selection for testing
+ */
+SimIsa ClassSimZ80_AVX2::detectIsa()
+{
+    SimIsa isa = SimIsa::Scalar;
+#if SIM_X86
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    const int maxLeaf = r[0];
+    __cpuid(r, 1);
+    const bool sse2 = r[3] & (1 << 26);
+    const bool osxsave = r[2] & (1 << 27);
+    const uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx2 = false, avx512 = false;
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(r, 7, 0);
+        avx2 = (r[1] & (1 << 5)) && ((xcr0 & 0x06) == 0x06);     // XMM and YMM state
+        avx512 = (r[1] & (1 << 16)) && ((xcr0 & 0xE6) == 0xE6);  // and opmask, ZMM state
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    const bool avx512 = __builtin_cpu_supports("avx512f");
+#endif
+    if (avx512)
+        isa = SimIsa::AVX512;
+    else if (avx2)
+        isa = SimIsa::AVX2;
+    else if (sse2)
+        isa = SimIsa::SSE2;
+#endif
+    const QString cap = qEnvironmentVariable("Z80_SIM_ISA").toLower();
+    for (SimIsa i : { SimIsa::Scalar, SimIsa::SSE2, SimIsa::AVX2 })
+        if ((cap == QString(isaName(i)).toLower()) && (i < isa))
+            isa = i;
+    return isa;
+}
+
+const char *ClassSimZ80_AVX2::isaName(SimIsa isa)
+{
+    switch (isa)
+    {
+        case SimIsa::SSE2: return "SSE2";
+        case SimIsa::AVX2: return "AVX2";
+        case SimIsa::AVX512: return "AVX512";
+        default: return "Scalar";
+    }
 }
 
-// Set bit using x64 BTS instruction
-__forceinline void ClassSimZ80_AVX2::setBit(uint64_t* bitset, net_t n)
+void ClassSimZ80_AVX2::selectKernels(SimIsa isa)
 {
-    _bittestandset64(reinterpret_cast<__int64*>(bitset), n);
+    m_isa = isa;
+    m_clearBitset = clearBitset_Scalar;
+    m_edgeMask = edgeMask_Scalar; // SSE2 has no gathers
+#if SIM_X86
+    if (isa == SimIsa::SSE2)
+        m_clearBitset = clearBitset_SSE2;
+    if (isa == SimIsa::AVX2)
+    {
+        m_clearBitset = clearBitset_AVX2;
+        m_edgeMask = edgeMask_AVX2;
+    }
+    if (isa == SimIsa::AVX512)
+    {
+        m_clearBitset = clearBitset_AVX512;
+        m_edgeMask = edgeMask_AVX512;
+    }
+#endif
 }
 
 //=============================================================================
@@ -91,6 +310,7 @@ __forceinline void ClassSimZ80_AVX2::setBit(uint64_t* bitset, net_t n)
 bool ClassSimZ80_AVX2::loadResources(const QString dir)
 {
     qInfo() << "Loading AVX2-optimized netlist resources from" << dir;
+    qInfo() << "Using" << isaName(m_isa) << "simulation kernels";
 
     if (loadNetNames(dir + "/nodenames.js", false))
     {
@@ -123,7 +343,18 @@ bool ClassSimZ80_AVX2::loadResources(const QString dir)
         {
             if (loadTransdefs(dir) && loadPullups(dir))
             {
+                m_gatesEnabled = qEnvironmentVariable("Z80_SIM_GATES") != "0";
+                m_slicesEnabled = qEnvironmentVariable("Z80_SIM_SLICES") != "0";
+                m_incremental = qEnvironmentVariable("Z80_SIM_INCREMENTAL") == "1";
+                m_waveDedup = qEnvironmentVariable("Z80_SIM_WAVE_DEDUP") == "1";
+                m_tracked = m_incremental || m_waveDedup;
                 convertToAVX2Layout();
+                if (qEnvironmentVariableIntValue("Z80_SIM_THREADS") > 1)
+                    setThreads(qEnvironmentVariableIntValue("Z80_SIM_THREADS"));
+                if (qEnvironmentVariable("Z80_SIM_LOOP_SKIP") == "0")
+                    m_loopSkip = false;
+                if (qEnvironmentVariableIsSet("Z80_SIM_CONSTANTS"))
+                    loadConstants(qEnvironmentVariable("Z80_SIM_CONSTANTS"), qEnvironmentVariable("Z80_SIM_CONSTANTS_OBSERVED") == "1");
                 qInfo() << "Completed loading AVX2-optimized netlist resources";
                 return true;
             }
@@ -306,7 +537,7 @@ bool ClassSimZ80_AVX2::loadTransdefs(const QString dir)
                         m_transGate[i] = list[1].toUInt();
                         m_transC1[i] = list[2].toUInt();
                         m_transC2[i] = list[3].toUInt();
-                        m_transOn[i] = 0; // Off by default
+                        clearBit(m_transOn, i); // Off by default
 
                         // Normalize: c1 should be the non-power net
                         if (m_transC1[i] <= nclk)
@@ -333,18 +564,18 @@ bool ClassSimZ80_AVX2::loadTransdefs(const QString dir)
 
         // Calculate total pool sizes needed
         m_gatesPoolSize = 0;
-        m_c1c2sPoolSize = 0;
+        m_adjPoolSize = 0;
         for (int n = 0; n < MAX_NETS; n++)
         {
             m_gatesPoolSize += tempGates[n].size();
-            m_c1c2sPoolSize += tempC1c2s[n].size();
+            m_adjPoolSize += tempC1c2s[n].size();
         }
 
         // Allocate memory pools (aligned for potential SIMD access)
-        m_gatesPool = static_cast<tran_t*>(_aligned_malloc(m_gatesPoolSize * sizeof(tran_t), CACHE_LINE_SIZE));
-        m_c1c2sPool = static_cast<tran_t*>(_aligned_malloc(m_c1c2sPoolSize * sizeof(tran_t), CACHE_LINE_SIZE));
+        m_gatesPool = static_cast<tran_t*>(alignedAlloc(m_gatesPoolSize * sizeof(tran_t), CACHE_LINE_SIZE));
+        m_adjPool = static_cast<NetEdge*>(alignedAlloc(m_adjPoolSize * sizeof(NetEdge), CACHE_LINE_SIZE));
 
-        if (!m_gatesPool || !m_c1c2sPool)
+        if (!m_gatesPool || !m_adjPool)
         {
             qCritical() << "Failed to allocate memory pools";
             return false;
@@ -352,7 +583,7 @@ bool ClassSimZ80_AVX2::loadTransdefs(const QString dir)
 
         // Copy data to pools and set up pointers
         tran_t* gatesPtr = m_gatesPool;
-        tran_t* c1c2sPtr = m_c1c2sPool;
+        NetEdge* adjPtr = m_adjPool;
 
         for (int n = 0; n < MAX_NETS; n++)
         {
@@ -369,22 +600,26 @@ bool ClassSimZ80_AVX2::loadTransdefs(const QString dir)
                 m_netlist[n].gatesTrans = nullptr;
             }
 
-            // C1C2s
+            // C1C2s, with the net on the other side of each transistor resolved up front
             m_netlist[n].c1c2sCount = uint16_t(tempC1c2s[n].size());
             if (m_netlist[n].c1c2sCount > 0)
             {
-                m_netlist[n].c1c2sTrans = c1c2sPtr;
-                memcpy(c1c2sPtr, tempC1c2s[n].constData(), tempC1c2s[n].size() * sizeof(tran_t));
-                c1c2sPtr += tempC1c2s[n].size();
+                m_netlist[n].c1c2s = adjPtr;
+                for (tran_t t : tempC1c2s[n])
+                {
+                    adjPtr->t = t;
+                    adjPtr->other = (m_transC1[t] == n) ? m_transC2[t] : m_transC1[t];
+                    adjPtr++;
+                }
             }
             else
             {
-                m_netlist[n].c1c2sTrans = nullptr;
+                m_netlist[n].c1c2s = nullptr;
             }
         }
 
         qInfo() << "Loaded" << count << "transistors into AVX2-optimized SoA layout";
-        qInfo() << "Gates pool:" << m_gatesPoolSize << "entries, C1C2s pool:" << m_c1c2sPoolSize << "entries";
+        qInfo() << "Gates pool:" << m_gatesPoolSize << "entries, C1C2s adjacency:" << m_adjPoolSize << "entries";
 
         return true;
     }
@@ -416,7 +651,7 @@ bool ClassSimZ80_AVX2::loadPullups(const QString dir)
                     uint i = list[0].toUInt();
                     Q_ASSERT(i < MAX_NETS);
                     m_netlist[i].hasPullup = list[1].contains('+');
-                    m_netlist[i].isHigh = list[1].contains('+');
+                    writeBit(m_netHigh, i, list[1].contains('+'));
                     if (m_netlist[i].hasPullup)
                         count++;
                 }
@@ -431,24 +666,303 @@ bool ClassSimZ80_AVX2::loadPullups(const QString dir)
 
 void ClassSimZ80_AVX2::convertToAVX2Layout()
 {
-    // Any additional conversion needed after loading
+    markFloatingNets();
+    buildDriverWords();
+    buildComponents();
+    buildGates();
     qInfo() << "AVX2-optimized data layout conversion complete";
 }
 
+/*
+ * Partitions the nets into channel-connected components (union-find over transistor source/drain pairs)
+ * Power nets connect to nearly everything and terminate the group search, so they are left out of the union.
+ */
+void ClassSimZ80_AVX2::buildComponents()
+{
+    static uint16_t parent[MAX_NETS];
+    auto find = [](net_t n)
+    {
+        while (parent[n] != n)
+            n = parent[n] = parent[parent[n]];
+        return n;
+    };
+    for (net_t n = 0; n < MAX_NETS; n++)
+        parent[n] = n;
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+    {
+        if (!m_transGate[t] || m_transFolded[t] || (m_transC1[t] <= npwr) || (m_transC2[t] <= npwr))
+            continue;
+        net_t a = find(m_transC1[t]), b = find(m_transC2[t]);
+        if (a != b)
+            parent[qMax(a, b)] = qMin(a, b); // Keep the lowest net number as the root
+    }
+
+    static uint16_t size[MAX_NETS];
+    memset(size, 0, sizeof(size));
+    memset(m_cccWordMask, 0, sizeof(m_cccWordMask));
+    m_cccCount = 0;
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        net_t root = find(n);
+        // The root has the lowest net number in its component, so its id is always assigned first
+        uint16_t id = (root == n) ? m_cccCount++ : m_netlist[root].ccc;
+        m_netlist[n].ccc = id;
+        size[id]++;
+        m_cccWordMask[id] |= (1ULL << (n >> 6)) | 1ULL; // Word 0 holds the power nets
+    }
+    uint largest = 0;
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        m_netlist[n].cccSize = size[m_netlist[n].ccc];
+        largest = qMax(largest, uint(m_netlist[n].cccSize));
+    }
+
+    // Number the transistors within their components; a transistor belongs to the component of its non-power net
+    static uint8_t trans[MAX_NETS];
+    memset(trans, 0, sizeof(trans));
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+    {
+        if (!m_transGate[t])
+            continue;
+        m_transCcc[t] = m_netlist[(m_transC1[t] > npwr) ? m_transC1[t] : m_transC2[t]].ccc;
+        if (!m_transFolded[t])
+            trans[m_transCcc[t]] = uint8_t(qMin(trans[m_transCcc[t]] + 1, 255));
+    }
+
+    // Components of a single net have their own fast path; the rest are cached if their keys fit in 64 bits
+    std::vector<bool> cacheable(m_cccCount);
+    for (uint id = 0; id < m_cccCount; id++)
+        cacheable[id] = (size[id] > 1) && (size[id] <= GROUP_CACHE_MAX_NETS) && (trans[id] <= 64);
+    uint cached = 0;
+    for (net_t n = npwr + 1; n < MAX_NETS; n++)
+    {
+        m_netlist[n].cached = cacheable[m_netlist[n].ccc];
+        cached += m_netlist[n].cached;
+    }
+    buildSlices(cacheable);
+    memset(m_cccPull, 0, sizeof(m_cccPull));
+    for (net_t n = npwr + 1; n < MAX_NETS; n++)
+        updatePull(n);
+    memset(m_netGen, 0xFF, sizeof(m_netGen)); // The component ids have changed
+    memset(m_cccOn, 0, sizeof(m_cccOn));
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+    {
+        if (m_transGate[t] && testBit(m_transOn, t)) // The components are rebuilt when the netlist is reduced (loadConstants())
+            m_cccOn[m_transCcc[t]] ^= m_transCccBit[t];
+    }
+
+    if (!m_groupCache)
+        m_groupCache = static_cast<GroupCacheEntry*>(alignedAlloc(sizeof(GroupCacheEntry) << GROUP_CACHE_BITS, CACHE_LINE_SIZE));
+    memset(m_groupCache, 0, sizeof(GroupCacheEntry) << GROUP_CACHE_BITS);
+
+    buildConflicts();
+
+    qInfo() << "Channel-connected components:" << m_cccCount << "largest has" << largest << "nets;" << cached << "nets use the group cache";
+}
+
+/*
+ * Numbers the nets and transistors of each cached component in a canonical order, so that the isomorphic components
+ * (the replicated bit slices) get the same local numbering, and with it the same group cache entries.
+ * The component is walked from each of its nets in the adjacency order, encoding the gate count and the adjacency of
+ * every net that it reaches; the smallest encoding gives the numbering, and the components with equal encodings form
+ * a slice class. For the same on-state and pulls, they resolve the same groups (by local index) in the same order.
+ */
+void ClassSimZ80_AVX2::buildSlices(const std::vector<bool> &cacheable)
+{
+    std::vector<std::vector<net_t>> nets(m_cccCount);
+    for (net_t n = npwr + 1; n < MAX_NETS; n++)
+    {
+        if (cacheable[m_netlist[n].ccc])
+            nets[m_netlist[n].ccc].push_back(n);
+    }
+
+    std::map<std::vector<uint16_t>, uint> classes;
+    std::vector<uint> members;          // Number of components in each class
+    std::vector<uint16_t> firstCcc;     // First component of each class, for the report
+    std::vector<int8_t> netLocal(MAX_NETS, -1), transLocal(MAX_TRANS, -1);
+    std::vector<uint16_t> code, best;
+    std::vector<net_t> order, bestOrder;
+    std::vector<tran_t> trans, bestTrans;
+    memset(m_netCacheKey, 0, sizeof(m_netCacheKey));
+    memset(m_transCccBit, 0, sizeof(m_transCccBit));
+    m_cccNets.clear();
+    for (uint16_t id = 0; id < m_cccCount; id++)
+    {
+        if (nets[id].empty())
+            continue;
+        best.clear();
+        for (net_t start : nets[id])
+        {
+            code.clear();
+            order.assign(1, start);
+            trans.clear();
+            netLocal[start] = 0;
+            for (uint i = 0; i < order.size(); i++)
+            {
+                const NetAVX2 &net = m_netlist[order[i]];
+                code.push_back(net.gatesCount);
+                code.push_back(net.c1c2sCount);
+                for (uint16_t j = 0; j < net.c1c2sCount; j++)
+                {
+                    const NetEdge &e = net.c1c2s[j];
+                    if (transLocal[e.t] < 0)
+                    {
+                        transLocal[e.t] = int8_t(trans.size());
+                        trans.push_back(e.t);
+                    }
+                    code.push_back(uint16_t(transLocal[e.t]));
+                    if (e.other <= npwr)
+                    {
+                        code.push_back(0x8000 | e.other);
+                        continue;
+                    }
+                    if (netLocal[e.other] < 0)
+                    {
+                        netLocal[e.other] = int8_t(order.size());
+                        order.push_back(e.other);
+                    }
+                    code.push_back(uint16_t(netLocal[e.other]));
+                }
+            }
+            for (net_t n : order)
+                netLocal[n] = -1;
+            for (tran_t t : trans)
+                transLocal[t] = -1;
+            if (best.empty() || (code < best))
+            {
+                best.swap(code);
+                bestOrder.swap(order);
+                bestTrans.swap(trans);
+            }
+            if (!m_slicesEnabled) // The numbering from the lowest net, and a class of its own
+                break;
+        }
+
+        uint slice = uint(members.size());
+        if (m_slicesEnabled)
+            slice = classes.emplace(best, slice).first->second;
+        if (slice == members.size())
+        {
+            members.push_back(0);
+            firstCcc.push_back(id);
+        }
+        members[slice]++;
+        m_cccNetStart[id] = uint(m_cccNets.size());
+        for (uint i = 0; i < bestOrder.size(); i++)
+        {
+            m_netPullShift[bestOrder[i]] = uint8_t(i * 2);
+            m_netCacheKey[bestOrder[i]] = ((slice << 5) | i) + 1;
+            m_cccNets.push_back(bestOrder[i]);
+        }
+        m_cccNets.push_back(ngnd);
+        m_cccNets.push_back(npwr);
+        for (uint i = 0; i < bestTrans.size(); i++)
+            m_transCccBit[bestTrans[i]] = 1ULL << i;
+    }
+
+    m_sliceClasses = m_sliceComponents = 0;
+    QStringList largest;
+    for (uint slice = 0; slice < members.size(); slice++)
+    {
+        if (members[slice] < 2)
+            continue;
+        m_sliceClasses++;
+        m_sliceComponents += members[slice];
+        if (members[slice] < 4)
+            continue;
+        QString name = QString::number(nets[firstCcc[slice]].front()); // The first named net of the first component
+        for (net_t n : nets[firstCcc[slice]])
+        {
+            if (!get(n).isEmpty())
+            {
+                name = get(n);
+                break;
+            }
+        }
+        largest.append(QString("%1x%2 (%3)").arg(members[slice]).arg(nets[firstCcc[slice]].size()).arg(name));
+    }
+    qInfo() << "Bit slices:" << m_sliceClasses << "classes of" << m_sliceComponents << "isomorphic components share the group cache:"
+            << qPrintable(largest.join(", "));
+}
+
+/*
+ * Recognizes the static gates (see SimGate), the structures that the logic equations of the schematics recognize in
+ * ClassNetlist::parse(): inverters, NOR gates, NAND gates through the pass-transistor nets, and push/pull drivers.
+ * The output and the nets in series become a boolean node; any other net, and the inputs and the nets that can float,
+ * keep the switch-level group resolution. A gate's paths must all qualify before its nets in series are claimed.
+ */
+void ClassSimZ80_AVX2::buildGates()
+{
+    m_gates.clear();
+    m_gatePaths.clear();
+    for (net_t n = 0; n < MAX_NETS; n++)
+        m_netlist[n].gate = 0;
+    if (!m_gatesEnabled)
+        return;
+
+    const QVector<bool> input = getInputNets();
+    auto inSeries = [&](net_t x)
+    {
+        const NetAVX2 &net = m_netlist[x];
+        return !input[x] && !net.floats && !net.hasPullup && !net.gatesCount && (net.c1c2sCount == 2) && !net.gate;
+    };
+    uint series = 0;
+    for (net_t n = npwr + 1; n < MAX_NETS; n++)
+    {
+        const NetAVX2 &net = m_netlist[n];
+        if (input[n] || net.floats || !net.c1c2sCount || net.gate)
+            continue;
+        std::vector<GatePath> paths;
+        bool ok = true;
+        for (uint i = 0; (i < net.c1c2sCount) && ok; i++)
+        {
+            GatePath p {};
+            NetEdge e = net.c1c2s[i];
+            while (true)
+            {
+                p.t[p.len] = e.t;
+                p.v[p.len++] = e.other;
+                if (e.other <= npwr)
+                    break;
+                ok = (p.len < GATE_MAX_SERIES) && (e.other != n) && inSeries(e.other);
+                if (!ok)
+                    break;
+                const NetAVX2 &x = m_netlist[e.other];
+                e = (x.c1c2s[0].t == e.t) ? x.c1c2s[1] : x.c1c2s[0];
+            }
+            paths.push_back(p);
+        }
+        if (!ok)
+            continue;
+
+        const uint16_t id = uint16_t(m_gates.size() + 1);
+        m_gates.push_back({ n, uint16_t(m_gatePaths.size()), uint16_t(paths.size()) });
+        m_netlist[n].gate = id;
+        for (const GatePath &p : paths)
+        {
+            for (uint j = 0; j + 1 < p.len; j++)
+            {
+                m_netlist[p.v[j]].gate = id;
+                m_netGatePath[p.v[j]] = uint16_t(m_gatePaths.size());
+                m_netGatePos[p.v[j]] = uint8_t(j);
+                series++;
+            }
+            m_gatePaths.push_back(p);
+        }
+    }
+    qInfo() << "Static gates:" << m_gates.size() << "outputs and" << series << "nets in series are evaluated as boolean nodes";
+}
+
 //=============================================================================
 // CHIP INITIALIZATION
 //=============================================================================
 
-bool ClassSimZ80_AVX2::initChip()
+/*
+ * Marks the nets that can float (hi-Z): the bus control pins, the address pins and the internal data buses
+ * These are never treated as static gate nodes, so it runs before buildGates()
+ */
+bool ClassSimZ80_AVX2::markFloatingNets()
 {
-    Q_ASSERT(ngnd == 1);
-    Q_ASSERT(npwr == 2);
-
-    // Initialize GND and Vcc
-    m_netlist[ngnd].state = false;
-    m_netlist[npwr].state = true;
-
-    // Initialize nets which can float
     net_t mreq = get("_mreq");
     net_t iorq = get("_iorq");
     net_t rd = get("_rd");
@@ -475,9 +989,51 @@ bool ClassSimZ80_AVX2::initChip()
         qCritical() << "Unknown net name";
         return false;
     }
+    return true;
+}
+
+/*
+ * Collects the transistor bitset words of the sources and drains of each floating net, with the mask of its
+ * transistors in each word, so getNetStateEx() tests whether the net is driven a word at a time
+ */
+void ClassSimZ80_AVX2::buildDriverWords()
+{
+    m_driverWords.clear();
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        m_driverStart[n] = uint(m_driverWords.size());
+        if (!m_netlist[n].floats)
+            continue;
+        for (uint16_t i = 0; i < m_netlist[n].c1c2sCount; i++)
+        {
+            const tran_t t = m_netlist[n].c1c2s[i].t;
+            uint j = m_driverStart[n];
+            while ((j < m_driverWords.size()) && (m_driverWords[j].word != uint(t >> 6)))
+                j++;
+            if (j == m_driverWords.size())
+                m_driverWords.push_back({ 0, uint(t >> 6) });
+            m_driverWords[j].mask |= 1ULL << (t & 63);
+        }
+    }
+    m_driverStart[MAX_NETS] = uint(m_driverWords.size());
+}
+
+bool ClassSimZ80_AVX2::initChip()
+{
+    Q_ASSERT(ngnd == 1);
+    Q_ASSERT(npwr == 2);
+
+    // Initialize GND and Vcc
+    clearBit(m_netState, ngnd);
+    setBit(m_netState, npwr);
+
+    if (!markFloatingNets())
+        return false;
 
     // Turn off all transistors
     memset(m_transOn, 0, sizeof(m_transOn));
+    memset(m_cccOn, 0, sizeof(m_cccOn));
+    memset(m_netGen, 0xFF, sizeof(m_netGen));
 
     return true;
 }
@@ -496,20 +1052,41 @@ void ClassSimZ80_AVX2::onTimeout()
 }
 
 bool ClassSimZ80_AVX2::setPin(uint index, pin_t p)
+{
+    return (index < 32) && setPins(1u << index, uint(p != 0) << index);
+}
+
+/*
+ * Sets the input pins selected by the mask (bit 0 is "_int") to the values of their bits, settling them together
+ */
+bool ClassSimZ80_AVX2::setPins(uint mask, uint values)
 {
     const static QStringList pins = { "_int", "_nmi", "_busrq", "_wait", "_reset" };
-    if (index < uint(pins.count()))
+    if (mask >> pins.count())
+        return false;
+    net_t nets[5];
+    uint bits = 0, count = 0;
+    for (int i = 0; i < pins.count(); i++)
     {
-        set(p, pins[index]);
-        return true;
+        if (!((mask >> i) & 1))
+            continue;
+        nets[count] = get(pins[i]);
+        bits |= ((values >> i) & 1) << count++;
     }
-    return false;
+    set(nets, bits, count);
+    m_loopEvents++;
+    return true;
 }
 
 void ClassSimZ80_AVX2::doRunsim(uint ticks)
 {
     if (!m_runcount && !ticks)
         return;
+    if (!m_runcount && m_foldedChange)
+    {
+        qWarning() << "Folded constant net" << m_foldedChange.load() << "changed its state; reload the netlist to run again";
+        return;
+    }
     if (m_runcount)
         m_runcount = ticks;
     else
@@ -557,11 +1134,23 @@ uint ClassSimZ80_AVX2::doReset()
     recalcNetlist();
 
     m_hcycletotal = 0;
+    m_groupCacheHits = 0;
+    m_groupCacheMisses = 0;
+    m_groupReuses = 0;
+    m_waveDedups = 0;
+    m_perf = {};
+    m_checkpoints.clear();
+    m_checkpointInterval = CHECKPOINT_INTERVAL;
+    m_nextCheckpoint = UINT_MAX;
+    m_hcyclesSkipped = 0;
+    m_gateEvals = 0;
+    m_loopEvents++;
 
     for (int i = 0; i < 8; i++)
         halfCycle();
 
     set(1, "_reset");
+    takeCheckpoint();
 
     return m_hcycletotal;
 }
@@ -570,8 +1159,12 @@ uint ClassSimZ80_AVX2::doReset()
 // CORE SIMULATION - AVX2 OPTIMIZED HOT PATH
 //=============================================================================
 
-__forceinline void ClassSimZ80_AVX2::halfCycle()
+SIM_INLINE void ClassSimZ80_AVX2::halfCycle()
 {
+    SIM_PERF(const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now());
+    if (Q_UNLIKELY(m_trace))
+        m_trace->hcycles.append(m_trace->inputs.count());
+
     // Use cached net_t values instead of QString lookups - major perf win
     const pin_t clk = readBit(nclk);
     if (!clk && readBit(n_rfsh))
@@ -586,7 +1179,11 @@ __forceinline void ClassSimZ80_AVX2::halfCycle()
         const bool t3   = readBit(n_t3);
 
         if (!m1 && rfsh && !mreq && !rd &&  wr &&  iorq && t2)
-            handleMemRead(readAB());
+        {
+            const uint16_t ab = readAB();
+            skipLoop(ab);
+            handleMemRead(ab);
+        }
         else if ( m1 && rfsh && !mreq && !rd &&  wr &&  iorq && t3)
             handleMemRead(readAB());
         else if ( m1 && rfsh && !mreq &&  rd && !wr &&  iorq && t3)
@@ -618,271 +1215,1781 @@ __forceinline void ClassSimZ80_AVX2::halfCycle()
 
     m_hcyclecnt.fetchAndAddRelaxed(1);
     m_hcycletotal.fetchAndAddRelaxed(1);
+    if (Q_UNLIKELY(uint(m_hcycletotal) >= m_nextCheckpoint))
+        takeCheckpoint();
+    if (Q_UNLIKELY(m_foldedChange.load(std::memory_order_relaxed)))
+        stopFolded();
+#if SIM_PERF_COUNTERS
+    const quint64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    m_perf.halfCycles++;
+    m_perf.halfCycleNs += ns;
+    m_perf.maxHalfCycleNs = qMax(m_perf.maxHalfCycleNs, ns);
+#endif
 }
 
-__forceinline void ClassSimZ80_AVX2::recalcNetlist()
+/*
+ * Topology of the loaded netlist: the group search walks the adjacency rows, the gate fan-out is the gate list of the
+ * net, and the nets of the static gates resolve without the group search
+ */
+struct ClassSimZ80_AVX2::NetlistTopology
 {
-    m_recalcListIndex = 0;
-    clearBitset_AVX2(m_recalcBitset);
-
-    while (m_listIndex)
+    static SIM_INLINE void getNetGroup(ClassSimZ80_AVX2 &s, net_t n) { s.getNetGroup(n); }
+    static SIM_INLINE bool getGateGroup(ClassSimZ80_AVX2 &s, net_t n, bool &value) { return s.getGateGroup(n, value); }
+    template <typename Flip> static SIM_INLINE void forGates(ClassSimZ80_AVX2 &s, net_t n, Flip flip)
     {
-        for (int i = 0; i < m_listIndex; i++)
-            recalcNet(m_list[i]);
-
-        memcpy(m_list, m_recalcList, m_recalcListIndex * sizeof(net_t));
-        m_listIndex = m_recalcListIndex;
-        m_recalcListIndex = 0;
-        clearBitset_AVX2(m_recalcBitset);
+        const NetAVX2 &net = s.m_netlist[n];
+        for (uint16_t i = 0; i < net.gatesCount; i++)
+        {
+            const tran_t t = net.gatesTrans[i];
+            flip(t, s.m_transC1[t], s.m_transC2[t]);
+        }
     }
-}
+};
 
-__forceinline void ClassSimZ80_AVX2::recalcNet(net_t n)
+void ClassSimZ80_AVX2::recalcNetlist()
 {
-    if (n <= npwr) return;
-
-    getNetGroup(n);
-    bool newState = getNetValue();
+    recalcWaves<NetlistTopology>();
+}
 
-    // Process all nets in the group
-    net_t* groupEnd = m_group + m_groupIndex;
-    for (net_t* p = m_group; p < groupEnd; p++)
+/*
+ * Resolves the group of a net of a static gate and its value without the group search, the same as the switch-level
+ * resolution would. The nets in series are gateless, so their order in the group does not matter; a power net goes
+ * first, as the group search puts it. Returns false if conducting paths reach both power nets: the value then depends
+ * on the search order, and the group search resolves it.
+ */
+SIM_INLINE bool ClassSimZ80_AVX2::getGateGroup(net_t n, bool &value)
+{
+    const SimGate &g = m_gates[m_netlist[n].gate - 1];
+    m_group[0] = n;
+    m_groupIndex = 1;
+    if (n != g.out)
     {
-        NetAVX2& net = m_netlist[*p];
-        if (net.state == newState) continue;
-        net.state = newState;
-
-        // Get the transistor indices for this net's gates
-        tran_t* gates = net.gatesTrans;
-        uint16_t gatesCount = net.gatesCount;
-
-        if (newState)
+        // A net in series reaches the output only if all transistors above it are on
+        const GatePath &p = m_gatePaths[m_netGatePath[n]];
+        const int pos = m_netGatePos[n];
+        int k = pos;
+        while ((k >= 0) && testBit(m_transOn, p.t[k]))
+            k--;
+        if (k >= 0)
         {
-            // Net went HIGH - turn on transistors
-            for (uint16_t i = 0; i < gatesCount; i++)
+            for (int j = pos; j > k; j--)
+                m_group[m_groupIndex++] = p.v[j - 1];
+            value = false; // Gateless nets without a pull resolve low
+            for (int j = pos + 1; (j < p.len) && testBit(m_transOn, p.t[j]); j++)
             {
-                tran_t t = gates[i];
-                if (!m_transOn[t])
+                if (p.v[j] <= npwr)
                 {
-                    m_transOn[t] = 1;
-                    addRecalcNet(m_transC1[t]);
+                    value = p.v[j] == npwr;
+                    m_group[m_groupIndex++] = m_group[0];
+                    m_group[0] = p.v[j];
+                    break;
                 }
+                m_group[m_groupIndex++] = p.v[j];
             }
+            return true;
         }
-        else
+        m_group[0] = g.out;
+    }
+
+    bool low = false, high = false;
+    const GatePath *end = m_gatePaths.data() + g.pathStart + g.pathCount;
+    for (const GatePath *p = m_gatePaths.data() + g.pathStart; p < end; p++)
+    {
+        for (int j = 0; (j < p->len) && testBit(m_transOn, p->t[j]); j++)
         {
-            // Net went LOW - turn off transistors
-            for (uint16_t i = 0; i < gatesCount; i++)
+            if (p->v[j] <= npwr)
             {
-                tran_t t = gates[i];
-                if (m_transOn[t])
-                {
-                    m_transOn[t] = 0;
-                    addRecalcNet(m_transC1[t]);
-                    addRecalcNet(m_transC2[t]);
-                }
+                low |= p->v[j] == ngnd;
+                high |= p->v[j] == npwr;
+                break;
             }
+            m_group[m_groupIndex++] = p->v[j];
         }
     }
+    if (low && high)
+        return false;
+    if (low || high) // Like the group search, the power net goes first; its state is set as well
+    {
+        m_group[m_groupIndex++] = m_group[0];
+        m_group[0] = high ? npwr : ngnd;
+    }
+    value = high || (!low && (testBit(m_netHigh, g.out) || (!testBit(m_netLow, g.out) && m_netlist[g.out].gatesCount && testBit(m_netState, g.out))));
+    return true;
 }
 
-__forceinline bool ClassSimZ80_AVX2::getNetValue()
+/*
+ * Stores the group just resolved from net n, along with the source of its value, into a group cache entry
+ * This mirrors getNetValue(): a power net or a pulled net gives a constant value, otherwise the value follows
+ * the state of the net with the most gates, which is only known at the time of the lookup
+ * The nets are stored by their local index, so that the isomorphic components can use the entry (see buildSlices())
+ */
+void ClassSimZ80_AVX2::storeGroup(GroupCacheEntry& e, net_t n, uint64_t on, uint64_t pull, const net_t* group, int count)
 {
-    // Fast path: check first element for power connections
-    if (m_group[0] <= npwr)
-        return m_group[0] == npwr;
-
-    // Single pass: pullups/pulldowns get immediate early exit (highest priority);
-    // simultaneously track the strongest floating net by gate-connection count.
-    // isHigh/isLow are rare — most nets are floating — so the common path is
-    // the max_conn comparison, which the compiler can lower to CMOV.
-    net_t* groupEnd = m_group + m_groupIndex;
-    bool max_state = false;
+    const uint size = m_netlist[n].cccSize;
+    e.key = m_netCacheKey[n];
+    e.on = on;
+    e.pull = pull;
+    e.reusable = m_tracked && isGroupReusable(group, count); // Only the modes that reuse groups need it
+    e.count = uint8_t(count);
+    for (int i = 0; i < count; i++)
+        e.group[i] = uint8_t((group[i] <= npwr) ? size + (group[i] == npwr) : m_netPullShift[group[i]] >> 1);
+    e.source = 0;
+    e.value = false;
+    if (group[0] <= npwr)
+    {
+        e.value = group[0] == npwr;
+        return;
+    }
     uint16_t max_conn = 0;
-
-    for (net_t* p = m_group; p < groupEnd; p++)
+    for (int i = 0; i < count; i++)
     {
-        NetAVX2& net = m_netlist[*p];
-        if (Q_UNLIKELY(net.isHigh)) return true;
-        if (Q_UNLIKELY(net.isLow)) return false;
+        const NetAVX2& net = m_netlist[group[i]];
+        if (isPulled(group[i]))
+        {
+            e.source = 0;
+            e.value = testBit(m_netHigh, group[i]);
+            return;
+        }
         if (net.gatesCount > max_conn)
         {
             max_conn = net.gatesCount;
-            max_state = net.state;
+            e.source = e.group[i] + 1;
         }
     }
-    return max_state;
 }
 
-__forceinline void ClassSimZ80_AVX2::getNetGroup(net_t n)
+/*
+ * Marks the nets of a group just resolved from net n as valid in the current generation of their component
+ * A group that is not reusable is not marked: its nets cannot hold a valid mark from this generation either, since
+ * they would have been found in the same group, which was not reusable then
+ */
+void ClassSimZ80_AVX2::markGroupValid(net_t n, const net_t* group, int count)
 {
-    m_groupIndex = 0;
-    clearBitset_AVX2(m_groupBitset);
-    addNetToGroup(n);
+    const uint64_t gen = m_cccGen[m_netlist[n].ccc];
+    const uint64_t powerGen = (group[0] <= npwr) ? m_powerGen : 0;
+    for (int i = 0; i < count; i++)
+    {
+        m_netGen[group[i]] = gen;
+        m_netPowerGen[group[i]] = powerGen;
+    }
 }
 
-// CRITICAL HOT FUNCTION - This is 45% of CPU time
-__forceinline void ClassSimZ80_AVX2::addNetToGroup(net_t n)
+/*
+ * Returns true if the group resolves to the same value from any of its nets, so that it can stay valid for all of
+ * them (see recalcNet()). It does not if it holds both power nets, or, without a power net, nets pulled high and low:
+ * the first of them in the search order, which depends on the starting net, gives the value.
+ */
+bool ClassSimZ80_AVX2::isGroupReusable(const net_t* group, int count)
 {
-    // O(1) duplicate check - inlined for zero call overhead
-    const uint64_t mask = 1ULL << (n & 63);
-    uint64_t& word = m_groupBitset[n >> 6];
-    if (word & mask)
-        return;
-
-    // Mark as visited
-    word |= mask;
-
-    // Power nets go at position 0 for fast detection
-    if (n <= npwr)
+    uint64_t high = 0, low = 0;
+    bool gnd = false, pwr = false;
+    for (int i = 0; i < count; i++)
     {
-        m_group[m_groupIndex] = n;
-        std::swap(m_group[0], m_group[m_groupIndex]);
-        m_groupIndex++;
-        return;
+        const net_t n = group[i];
+        gnd |= n == ngnd;
+        pwr |= n == npwr;
+        high |= m_netHigh[n >> 6] >> (n & 63);
+        low |= m_netLow[n >> 6] >> (n & 63);
     }
+    if (gnd || pwr)
+        return !(gnd && pwr);
+    return !(high & low & 1);
+}
 
-    m_group[m_groupIndex++] = n;
-
-    // Get connection array directly (no QVector overhead!)
-    const tran_t* c1c2s = m_netlist[n].c1c2sTrans;
-    const uint16_t count = m_netlist[n].c1c2sCount;
-
-    // Unrolled inner loop for better ILP
-    uint16_t i = 0;
-
-    // Process 4 at a time when possible
-    for (; i + 3 < count; i += 4)
+SIM_INLINE void ClassSimZ80_AVX2::getNetGroup(net_t n)
+{
+    const NetAVX2& net = m_netlist[n];
+    if (net.cccSize == 1)
     {
-        tran_t t0 = c1c2s[i];
-        tran_t t1 = c1c2s[i + 1];
-        tran_t t2 = c1c2s[i + 2];
-        tran_t t3 = c1c2s[i + 3];
-
-        // Prefetch ahead
-        if (i + 7 < count)
+        // The net is alone in its component: the group is the net itself and the power nets it connects to
+        m_group[0] = n;
+        m_groupIndex = 1;
+        for (uint16_t i = 0; i < net.c1c2sCount; i++)
         {
-            _mm_prefetch(reinterpret_cast<const char*>(&m_transOn[c1c2s[i + 4]]), _MM_HINT_T0);
+            const NetEdge& e = net.c1c2s[i];
+            if (!testBit(m_transOn, e.t))
+                continue;
+            const net_t other = e.other;
+            if ((other == n) || (other == m_group[0]) || ((m_groupIndex > 2) && (other == m_group[2])))
+                continue;
+            m_group[m_groupIndex] = other;
+            std::swap(m_group[0], m_group[m_groupIndex]);
+            m_groupIndex++;
         }
+        return;
+    }
 
-        // Process transistor 0
-        if (m_transOn[t0])
+    // Clear only the bitset words that the component can touch; most components span one or two words
+    m_groupIndex = 0;
+    uint64_t words = m_cccWordMask[net.ccc];
+    while (words)
+    {
+        m_groupBitset[simCtz64(words)] = 0;
+        words &= words - 1;
+    }
+    if (net.cccSize > GROUP_MASKED_MIN_NETS)
+        addNetToGroupMasked(n);
+    else
+        addNetToGroup(n);
+}
+
+// CRITICAL HOT FUNCTION - This is 45% of CPU time
+// Depth-first search with an explicit stack; it visits the nets in the same order as the recursive search did
+SIM_INLINE void ClassSimZ80_AVX2::addNetToGroup(net_t n)
+{
+    // O(1) duplicate check - inlined for zero call overhead
+    setBit(m_groupBitset, n);
+    m_group[m_groupIndex++] = n;
+
+    GroupFrame* sp = m_groupStack;
+    *sp = { m_netlist[n].c1c2s, m_netlist[n].c1c2s + m_netlist[n].c1c2sCount, 0 };
+    while (sp >= m_groupStack)
+    {
+        if (sp->next == sp->end)
+        {
+            sp--;
+            continue;
+        }
+        const NetEdge e = *sp->next++;
+        SIM_PERF(m_perf.groupVisits++);
+        if (sp->next != sp->end)
+            SIM_PREFETCH(&m_netlist[sp->next->other]);
+        if (!testBit(m_transOn, e.t))
+            continue;
+
+        const net_t other = e.other;
+        const uint64_t mask = 1ULL << (other & 63);
+        uint64_t& word = m_groupBitset[other >> 6];
+        if (word & mask)
+            continue;
+
+        // Mark as visited
+        word |= mask;
+
+        // Power nets go at position 0 for fast detection
+        if (other <= npwr)
+        {
+            m_group[m_groupIndex] = other;
+            std::swap(m_group[0], m_group[m_groupIndex]);
+            m_groupIndex++;
+            continue;
+        }
+
+        m_group[m_groupIndex++] = other;
+        const NetAVX2& net = m_netlist[other];
+        *++sp = { net.c1c2s, net.c1c2s + net.c1c2sCount, 0 };
+    }
+}
+
+/*
+ * The same depth-first search for the large components, such as the buses: the edge mask kernel tests a whole row
+ * of the adjacency (up to 64 edges at a time) for the on-state of its transistors and the visited nets, and the search
+ * walks only the set bits of that mask. The transistors do not change during the search and the visited nets only
+ * accumulate, so an edge left out of the mask would also be skipped by addNetToGroup(); a net visited after its mask
+ * was taken is tested again. The nets are therefore visited in exactly the same order.
+ */
+SIM_INLINE void ClassSimZ80_AVX2::addNetToGroupMasked(net_t n)
+{
+    setBit(m_groupBitset, n);
+    m_group[m_groupIndex++] = n;
+
+    GroupFrame* sp = m_groupStack;
+    *sp = { m_netlist[n].c1c2s, m_netlist[n].c1c2s + m_netlist[n].c1c2sCount, 0 };
+    sp->mask = m_edgeMask(sp->next, int(qMin<ptrdiff_t>(64, sp->end - sp->next)), m_transOn, m_groupBitset);
+    SIM_PERF(m_perf.groupVisits += m_netlist[n].c1c2sCount);
+    while (sp >= m_groupStack)
+    {
+        if (!sp->mask)
+        {
+            // Rows longer than 64 edges continue with their next part
+            sp->next += 64;
+            if (sp->next >= sp->end)
+                sp--;
+            else
+                sp->mask = m_edgeMask(sp->next, int(qMin<ptrdiff_t>(64, sp->end - sp->next)), m_transOn, m_groupBitset);
+            continue;
+        }
+        const net_t other = sp->next[simCtz64(sp->mask)].other;
+        sp->mask &= sp->mask - 1;
+        const uint64_t mask = 1ULL << (other & 63);
+        uint64_t& word = m_groupBitset[other >> 6];
+        if (word & mask)
+            continue;
+        word |= mask;
+
+        // Power nets go at position 0 for fast detection
+        if (other <= npwr)
+        {
+            m_group[m_groupIndex] = other;
+            std::swap(m_group[0], m_group[m_groupIndex]);
+            m_groupIndex++;
+            continue;
+        }
+
+        m_group[m_groupIndex++] = other;
+        const NetAVX2& net = m_netlist[other];
+        *++sp = { net.c1c2s, net.c1c2s + net.c1c2sCount, 0 };
+        sp->mask = m_edgeMask(sp->next, int(qMin<ptrdiff_t>(64, sp->end - sp->next)), m_transOn, m_groupBitset);
+        SIM_PERF(m_perf.groupVisits += net.c1c2sCount);
+    }
+}
+
+// Keeps the pull bits of a cached component in sync with the net's pulls high and low
+SIM_INLINE void ClassSimZ80_AVX2::updatePull(net_t n)
+{
+    const NetAVX2& net = m_netlist[n];
+    if (!net.cached)
+        return;
+    const uint shift = m_netPullShift[n];
+    uint64_t& pull = m_cccPull[net.ccc];
+    pull = (pull & ~(3ULL << shift)) | (uint64_t(testBit(m_netHigh, n)) << shift) | (uint64_t(testBit(m_netLow, n)) << (shift + 1));
+}
+
+// Pulls an input net high or low
+SIM_INLINE void ClassSimZ80_AVX2::setPull(net_t n, bool on)
+{
+    writeBit(m_netHigh, n, on);
+    writeBit(m_netLow, n, !on);
+    updatePull(n);
+    m_cccGen[m_netlist[n].ccc]++;
+}
+
+void ClassSimZ80_AVX2::allNets()
+{
+    m_listIndex = 0;
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        if (n == ngnd || n == npwr)
+            continue;
+        if (m_netlist[n].gatesCount == 0 && m_netlist[n].c1c2sCount == 0)
+            continue;
+        m_list[m_listIndex++] = n;
+    }
+}
+
+//=============================================================================
+// PARALLEL WAVEFRONT
+//=============================================================================
+
+/*
+ * Lists, for every component, the components whose transistors its nets gate and the components whose nets gate its
+ * transistors. Evaluating a net of one of them may change what evaluating a net of the other one reads or writes,
+ * so within a wave, their nets are evaluated in the wave order; the nets of other components are independent.
+ * The power nets are in the groups of nearly all components instead: the components with transistors that they gate
+ * are marked, and their nets are evaluated after all the nets before them in the wave (see recalcWaveParallel()).
+ */
+void ClassSimZ80_AVX2::buildConflicts()
+{
+    QVector<QVector<uint16_t>> conflicts(m_cccCount);
+    memset(m_cccPowerGated, 0, sizeof(m_cccPowerGated));
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+    {
+        if (m_transGate[t] && (m_transGate[t] <= npwr) && (m_transC1[t] > npwr))
+            m_cccPowerGated[m_transCcc[t]] = true;
+        if (!m_transGate[t] || (m_transGate[t] <= npwr))
+            continue;
+        const uint16_t gate = m_netlist[m_transGate[t]].ccc, ccc = m_transCcc[t];
+        if (gate == ccc)
+            continue;
+        if (!conflicts[gate].contains(ccc))
+            conflicts[gate].append(ccc);
+        if (!conflicts[ccc].contains(gate))
+            conflicts[ccc].append(gate);
+    }
+    m_cccConflicts.clear();
+    for (uint i = 0; i < m_cccCount; i++)
+    {
+        m_cccConflictStart[i] = uint(m_cccConflicts.size());
+        m_cccConflicts.insert(m_cccConflicts.end(), conflicts[i].begin(), conflicts[i].end());
+    }
+    m_cccConflictStart[m_cccCount] = uint(m_cccConflicts.size());
+}
+
+// A worker's own group search buffers, and the nets its wave positions queued for the next wave
+struct WaveWorker
+{
+    alignas(CACHE_LINE_SIZE) uint64_t groupBitset[NET_WORDS];
+    net_t group[MAX_NETS];
+    ClassSimZ80_AVX2::GroupFrame stack[MAX_NETS];
+    int groupIndex {};
+    std::vector<net_t> queued;          // Nets queued for the next wave, in the order of evaluation
+    struct Flip { uint16_t ccc; uint64_t bit; };
+    std::vector<Flip> flips;            // Switched transistors' bits of m_cccOn and generations, applied when the level is done
+    struct Store { uint slot; GroupCacheEntry entry; };
+    std::vector<Store> stores;          // Resolved groups, written to the group cache when the level is done
+    quint64 hits {}, misses {};         // Group cache statistics of this worker
+    SimPerfCounters perf;               // Performance counters of this worker
+    uint index {};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint> next {0}; // Next position in this worker's range; other workers steal from it too
+    uint end {};
+    std::thread thread;
+};
+
+static void pinThread(std::thread &t, uint cpu)
+{
+    const uint cpus = qMax(1u, std::thread::hardware_concurrency());
+#if defined(_WIN32)
+    SetThreadAffinityMask(t.native_handle(), DWORD_PTR(1) << (cpu % cpus));
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cpus, &set);
+    pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+    Q_UNUSED(t);
+    Q_UNUSED(cpu);
+#endif
+}
+
+/*
+ * Sets the number of threads evaluating the waves of at least PARALLEL_MIN_WAVE nets, including the simulation thread
+ * The simulation thread takes part as worker 0; the other workers are pinned each to its own core.
+ * Environment variable Z80_SIM_THREADS sets the number of threads when the netlist is loaded.
+ */
+void ClassSimZ80_AVX2::setThreads(uint threads)
+{
+    threads = qBound(1u, threads, uint(PARALLEL_MAX_THREADS));
+    if (threads == m_threads)
+        return;
+    if (m_runcount)
+    {
+        qWarning() << "Unable to change the number of simulation threads while the simulation is running";
+        return;
+    }
+    stopWorkers();
+    m_threads = threads;
+    for (uint i = 0; (threads > 1) && (i < threads); i++)
+    {
+        m_workers.push_back(new WaveWorker);
+        m_workers[i]->index = i;
+        m_workers[i]->queued.reserve(MAX_NETS);
+    }
+    for (uint i = 1; i < m_workers.size(); i++)
+    {
+        m_workers[i]->thread = std::thread(&ClassSimZ80_AVX2::workerLoop, this, i, m_waveGeneration.load());
+        pinThread(m_workers[i]->thread, i);
+    }
+    qInfo() << "Simulation waves of" << PARALLEL_MIN_WAVE << "or more nets use" << m_threads << "threads";
+}
+
+// Stops and releases the worker pool; the simulation is serial until setThreads() starts a new one
+void ClassSimZ80_AVX2::stopWorkers()
+{
+    m_workersQuit = true;
+    startLevel();
+    for (uint i = 1; i < m_workers.size(); i++)
+        m_workers[i]->thread.join();
+    for (WaveWorker *w : m_workers)
+        delete w;
+    m_workers.clear();
+    m_workersQuit = false;
+    m_threads = 1;
+}
+
+// Starts the next level (or the stop) on the workers, waking up those that sleep
+void ClassSimZ80_AVX2::startLevel()
+{
+    m_waveGeneration.fetch_add(1, std::memory_order_seq_cst);
+    if (m_workersParked.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock(m_workersLock);
+        m_workersWake.notify_all();
+    }
+}
+
+// Waits for the levels that start after the given generation, until the pool is stopped
+// A worker polls for a while, then sleeps, so that the pool of an idle or stopped simulator leaves the cores free
+void ClassSimZ80_AVX2::workerLoop(uint index, uint seen)
+{
+    for (;;)
+    {
+        uint generation;
+        uint polls = 0;
+        while ((generation = m_waveGeneration.load(std::memory_order_acquire)) == seen)
+        {
+            if (++polls < PARALLEL_SPIN)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_workersLock);
+            m_workersParked.fetch_add(1, std::memory_order_seq_cst);
+            m_workersWake.wait(lock, [&] { return m_waveGeneration.load(std::memory_order_seq_cst) != seen; });
+            m_workersParked.fetch_sub(1, std::memory_order_relaxed);
+        }
+        seen = generation;
+        if (m_workersQuit)
+            return;
+        runWorker(*m_workers[index]);
+        m_waveDone.fetch_add(1, std::memory_order_release);
+    }
+}
+
+// Evaluates the positions of the worker's own range, then steals the remaining positions from the other workers
+void ClassSimZ80_AVX2::runWorker(WaveWorker &w)
+{
+    for (uint i = 0; i < m_threads; i++)
+    {
+        WaveWorker &victim = *m_workers[(w.index + i) % m_threads];
+        uint next;
+        while ((next = victim.next.fetch_add(1, std::memory_order_relaxed)) < victim.end)
+            recalcNetWorker(w, m_levelPos[next]);
+    }
+}
+
+/*
+ * Evaluates one wave (m_list) on all worker threads and lists the nets of the next wave in m_recalcList
+ * A net is placed one level after the last net before it in the wave whose component is its own or conflicts with it
+ * (buildConflicts), so the nets of a level are independent and the levels keep the order of any dependent nets: the
+ * result is exactly that of the serial evaluation. The nets queued by each position are then merged in the wave order.
+ * The power nets are shared by the groups of a level: a group that shorts them changes the state of the power net it
+ * does not take its value from, and the serial evaluation applies these changes in the wave order. The workers leave
+ * the power nets alone, and the changes are applied in the wave order once the level is done (applyPowerChanges()).
+ */
+void ClassSimZ80_AVX2::recalcWaveParallel()
+{
+    m_waveStamp++;
+    uint levels = 0;
+    for (int i = 0; i < m_listIndex; i++)
+    {
+        const uint16_t ccc = m_netlist[m_list[i]].ccc;
+        uint level = (m_cccStamp[ccc] == m_waveStamp) ? m_cccLevel[ccc] : 0;
+        for (uint j = m_cccConflictStart[ccc]; j < m_cccConflictStart[ccc + 1]; j++)
+        {
+            const uint16_t other = m_cccConflicts[j];
+            if ((m_cccStamp[other] == m_waveStamp) && (m_cccLevel[other] > level))
+                level = m_cccLevel[other];
+        }
+        if (m_cccPowerGated[ccc])
+            level = levels; // Any net before it may change a power net, which switches the component's transistors
+        m_cccStamp[ccc] = m_waveStamp;
+        m_cccLevel[ccc] = uint16_t(level + 1);
+        m_posLevel[i] = uint16_t(level);
+        levels = qMax(levels, level + 1);
+    }
+    // Sort the positions by level; walking the wave backwards from the end of each level keeps the wave order
+    memset(m_levelStart, 0, (levels + 1) * sizeof(uint));
+    for (int i = 0; i < m_listIndex; i++)
+        m_levelStart[m_posLevel[i]]++;
+    for (uint l = 1; l <= levels; l++)
+        m_levelStart[l] += m_levelStart[l - 1];
+    for (int i = m_listIndex - 1; i >= 0; i--)
+        m_levelPos[--m_levelStart[m_posLevel[i]]] = uint16_t(i);
+
+    for (WaveWorker *w : m_workers)
+        w->queued.clear();
+    for (uint l = 0; l < levels; l++)
+    {
+        const uint start = m_levelStart[l], count = m_levelStart[l + 1] - start;
+        if (count < PARALLEL_MIN_LEVEL)
+        {
+            WaveWorker &w = *m_workers[0];
+            for (uint i = start; i < start + count; i++)
+                recalcNetWorker(w, m_levelPos[i]);
+        }
+        else
+        {
+            for (WaveWorker *w : m_workers)
+            {
+                w->next.store(start + count * w->index / m_threads, std::memory_order_relaxed);
+                w->end = start + count * (w->index + 1) / m_threads;
+            }
+            m_waveDone.store(0, std::memory_order_relaxed);
+            startLevel();
+            runWorker(*m_workers[0]);
+            while (m_waveDone.load(std::memory_order_acquire) != m_threads - 1)
+                std::this_thread::yield();
+        }
+        // Components of one level can gate transistors of the same component, and their nets can share group cache
+        // entries, so these are only updated when the level is done
+        for (WaveWorker *w : m_workers)
+        {
+            for (const WaveWorker::Flip &f : w->flips)
+            {
+                m_cccOn[f.ccc] ^= f.bit;
+                m_cccGen[f.ccc] += m_tracked;
+            }
+            for (const WaveWorker::Store &st : w->stores)
+                m_groupCache[st.slot] = st.entry;
+            w->flips.clear();
+            w->stores.clear();
+        }
+        applyPowerChanges(start, count);
+    }
+
+    for (int i = 0; i < m_listIndex; i++)
+    {
+        const WaveOutput &out = m_waveOutput[i];
+        const net_t *queued = m_workers[out.worker]->queued.data() + out.start;
+        uint j = 0;
+        for (uint k = 0; k < out.powers; k++)
+        {
+            const PowerChange &c = out.power[k];
+            if (!c.taken)
+                continue;
+            for (; j < c.at; j++)
+                addRecalcNet(queued[j]);
+            const NetAVX2& net = m_netlist[c.net];
+            for (uint16_t g = 0; g < net.gatesCount; g++)
+            {
+                addRecalcNet(m_transC1[net.gatesTrans[g]]);
+                if (!c.value)
+                    addRecalcNet(m_transC2[net.gatesTrans[g]]);
+            }
+        }
+        for (; j < out.count; j++)
+            addRecalcNet(queued[j]);
+    }
+    for (WaveWorker *w : m_workers)
+    {
+        m_groupCacheHits += w->hits;
+        m_groupCacheMisses += w->misses;
+        w->hits = w->misses = 0;
+        SIM_PERF(m_perf += w->perf);
+        SIM_PERF(w->perf = {});
+    }
+}
+
+/*
+ * Applies the power nets of the groups of a level, in the wave order, as recalcNet() would have: a power net that is
+ * not at the group value changes its state and switches the transistors it gates; the merge of the wave queues their
+ * nets at the group's place (at) in the position's queued nets
+ */
+void ClassSimZ80_AVX2::applyPowerChanges(uint start, uint count)
+{
+    for (uint i = start; i < start + count; i++)
+    {
+        WaveOutput &out = m_waveOutput[m_levelPos[i]];
+        for (uint k = 0; k < out.powers; k++)
+        {
+            PowerChange &c = out.power[k];
+            c.taken = testBit(m_netState, c.net) != c.value;
+            if (!c.taken)
+                continue;
+            m_powerGen += m_tracked;
+            writeBit(m_netState, c.net, c.value);
+            if (m_training)
+                m_netChanged[c.net] = 1;
+            checkFoldedNet(c.net);
+            const NetAVX2& net = m_netlist[c.net];
+            for (uint16_t g = 0; g < net.gatesCount; g++)
+                m_tracked ? switchGate<true>(net.gatesTrans[g]) : switchGate<false>(net.gatesTrans[g]);
+        }
+    }
+}
+
+// Same evaluation as recalcNet() of the net at a wave position, using the worker's own buffers
+SIM_INLINE void ClassSimZ80_AVX2::recalcNetWorker(WaveWorker &w, uint pos)
+{
+    const net_t n = m_list[pos];
+    WaveOutput &out = m_waveOutput[pos];
+    SIM_PERF(w.perf.netRecalcs++);
+    out.start = uint(w.queued.size());
+    out.worker = uint8_t(w.index);
+    out.count = 0;
+    out.powers = 0;
+    if (n <= npwr) return;
+
+    const uint16_t ccc = m_netlist[n].ccc;
+    const net_t* group = nullptr;
+    int count = 0;
+    bool newState = false;
+    if (m_netlist[n].cached)
+    {
+        const uint64_t on = m_cccOn[ccc];
+        const uint64_t pull = m_cccPull[ccc];
+        const uint32_t key = m_netCacheKey[n];
+        const uint64_t hash = (on ^ (pull * 0x9E3779B97F4A7C15ULL) ^ (uint64_t(key) << 40)) * 0xD6E8FEB86659FD93ULL;
+        const GroupCacheEntry& e = m_groupCache[hash >> (64 - GROUP_CACHE_BITS)];
+        if ((e.key == key) && (e.on == on) && (e.pull == pull))
+        {
+            w.hits++;
+            const net_t* nets = &m_cccNets[m_cccNetStart[ccc]];
+            for (uint i = 0; i < e.count; i++)
+                w.group[i] = nets[e.group[i]];
+            group = w.group;
+            count = e.count;
+            newState = e.source ? testBitRelaxed(m_netState, nets[e.source - 1]) : e.value;
+        }
+        else
+        {
+            w.misses++;
+            w.stores.push_back({ uint(&e - m_groupCache), {} });
+            w.stores.back().entry.on = on;  // Stored once the group is resolved below
+            w.stores.back().entry.pull = pull;
+        }
+    }
+    if (!group)
+    {
+        uint64_t words = m_cccWordMask[ccc];
+        while (words)
+        {
+            w.groupBitset[simCtz64(words)] = 0;
+            words &= words - 1;
+        }
+        w.groupIndex = 0;
+        if (m_netlist[n].cccSize > GROUP_MASKED_MIN_NETS)
+            addNetToGroupMaskedWorker(w, n);
+        else
+            addNetToGroupWorker(w, n);
+        group = w.group;
+        count = w.groupIndex;
+        newState = getNetValue<true>(group, count);
+        if (m_netlist[n].cached)
+        {
+            GroupCacheEntry &e = w.stores.back().entry;
+            storeGroup(e, n, e.on, e.pull, group, count);
+        }
+    }
+    SIM_PERF(w.perf.groupSizes[SimPerfCounters::groupBin(count)]++);
+
+    for (const net_t* p = group; p < group + count; p++)
+    {
+        if (*p <= npwr)
+        {
+            out.power[out.powers++] = { uint16_t(w.queued.size() - out.start), uint8_t(*p), newState, false };
+            continue;
+        }
+        if (testBitRelaxed(m_netState, *p) == newState) continue;
+        writeBitAtomic(m_netState, *p, newState);
+        if (m_training)
+            m_netChanged[*p] = 1; // Observed by the constant-net folding
+        checkFoldedNet(*p);
+
+        const NetAVX2& net = m_netlist[*p];
+        for (uint16_t i = 0; i < net.gatesCount; i++)
+        {
+            const tran_t t = net.gatesTrans[i]; // Flips, as in recalcNet()
+            writeBitAtomic(m_transOn, t, newState);
+            if (m_tracked || m_transCccBit[t]) // Only the cached components have on-state bits
+                w.flips.push_back({ m_transCcc[t], m_transCccBit[t] });
+            w.queued.push_back(m_transC1[t]);
+            if (!newState)
+                w.queued.push_back(m_transC2[t]);
+        }
+    }
+    out.count = uint16_t(w.queued.size() - out.start);
+}
+
+// Same search as addNetToGroup(), using the worker's own group buffers
+SIM_INLINE void ClassSimZ80_AVX2::addNetToGroupWorker(WaveWorker &w, net_t n)
+{
+    setBit(w.groupBitset, n);
+    w.group[w.groupIndex++] = n;
+
+    GroupFrame* sp = w.stack;
+    *sp = { m_netlist[n].c1c2s, m_netlist[n].c1c2s + m_netlist[n].c1c2sCount, 0 };
+    while (sp >= w.stack)
+    {
+        if (sp->next == sp->end)
+        {
+            sp--;
+            continue;
+        }
+        const NetEdge e = *sp->next++;
+        SIM_PERF(w.perf.groupVisits++);
+        if (!testBitRelaxed(m_transOn, e.t))
+            continue;
+        const net_t other = e.other;
+        const uint64_t mask = 1ULL << (other & 63);
+        uint64_t& word = w.groupBitset[other >> 6];
+        if (word & mask)
+            continue;
+        word |= mask;
+        if (other <= npwr)
+        {
+            w.group[w.groupIndex] = other;
+            std::swap(w.group[0], w.group[w.groupIndex]);
+            w.groupIndex++;
+            continue;
+        }
+        w.group[w.groupIndex++] = other;
+        const NetAVX2& net = m_netlist[other];
+        *++sp = { net.c1c2s, net.c1c2s + net.c1c2sCount, 0 };
+    }
+}
+
+// Same search as addNetToGroupMasked(), using the worker's own group buffers and the edge mask kernel for the workers
+SIM_INLINE void ClassSimZ80_AVX2::addNetToGroupMaskedWorker(WaveWorker &w, net_t n)
+{
+    setBit(w.groupBitset, n);
+    w.group[w.groupIndex++] = n;
+
+    GroupFrame* sp = w.stack;
+    *sp = { m_netlist[n].c1c2s, m_netlist[n].c1c2s + m_netlist[n].c1c2sCount, 0 };
+    sp->mask = edgeMask_Relaxed(sp->next, int(qMin<ptrdiff_t>(64, sp->end - sp->next)), m_transOn, w.groupBitset);
+    SIM_PERF(w.perf.groupVisits += m_netlist[n].c1c2sCount);
+    while (sp >= w.stack)
+    {
+        if (!sp->mask)
+        {
+            sp->next += 64;
+            if (sp->next >= sp->end)
+                sp--;
+            else
+                sp->mask = edgeMask_Relaxed(sp->next, int(qMin<ptrdiff_t>(64, sp->end - sp->next)), m_transOn, w.groupBitset);
+            continue;
+        }
+        const net_t other = sp->next[simCtz64(sp->mask)].other;
+        sp->mask &= sp->mask - 1;
+        const uint64_t mask = 1ULL << (other & 63);
+        uint64_t& word = w.groupBitset[other >> 6];
+        if (word & mask)
+            continue;
+        word |= mask;
+        if (other <= npwr)
+        {
+            w.group[w.groupIndex] = other;
+            std::swap(w.group[0], w.group[w.groupIndex]);
+            w.groupIndex++;
+            continue;
+        }
+        w.group[w.groupIndex++] = other;
+        const NetAVX2& net = m_netlist[other];
+        *++sp = { net.c1c2s, net.c1c2s + net.c1c2sCount, 0 };
+        sp->mask = edgeMask_Relaxed(sp->next, int(qMin<ptrdiff_t>(64, sp->end - sp->next)), m_transOn, w.groupBitset);
+        SIM_PERF(w.perf.groupVisits += net.c1c2sCount);
+    }
+}
+
+//=============================================================================
+// PERFORMANCE COUNTERS
+//=============================================================================
+
+SimPerfCounters &SimPerfCounters::operator+=(const SimPerfCounters &c)
+{
+    netlistRecalcs += c.netlistRecalcs;
+    waves += c.waves;
+    maxWaves = qMax(maxWaves, c.maxWaves);
+    netRecalcs += c.netRecalcs;
+    waveDedups += c.waveDedups;
+    maxWaveDedups = qMax(maxWaveDedups, c.maxWaveDedups);
+    groupVisits += c.groupVisits;
+    for (uint i = 0; i < PERF_GROUP_BINS; i++)
+        groupSizes[i] += c.groupSizes[i];
+    setDBRecalcs += c.setDBRecalcs;
+    halfCycles += c.halfCycles;
+    halfCycleNs += c.halfCycleNs;
+    maxHalfCycleNs = qMax(maxHalfCycleNs, c.maxHalfCycleNs);
+    return *this;
+}
+
+/*
+ * Returns the counters as text, along with the averages that explain where the simulation time goes
+ */
+QString SimPerfCounters::toString() const
+{
+#if SIM_PERF_COUNTERS
+    auto avg = [](quint64 a, quint64 b) { return QString::number(b ? double(a) / b : 0.0, 'f', 1); };
+    quint64 groups = 0;
+    for (uint i = 0; i < PERF_GROUP_BINS; i++)
+        groups += groupSizes[i];
+    QString s = QString("Half-cycles: %1, %2 us each, longest %3 us\n").arg(halfCycles)
+        .arg(avg(halfCycleNs, halfCycles * 1000)).arg(avg(maxHalfCycleNs, 1000));
+    s += QString("recalcNetlist: %1 calls, %2 per half-cycle, %3 from setDB\n").arg(netlistRecalcs)
+        .arg(avg(netlistRecalcs, halfCycles)).arg(setDBRecalcs);
+    s += QString("Waves: %1, %2 per recalcNetlist, most %3\n").arg(waves).arg(avg(waves, netlistRecalcs)).arg(maxWaves);
+    s += QString("recalcNet: %1 calls, %2 per wave\n").arg(netRecalcs).arg(avg(netRecalcs, waves));
+    s += QString("Wave deduplication: %1 nets skipped, %2 per wave, most %3\n").arg(waveDedups).arg(avg(waveDedups, waves)).arg(maxWaveDedups);
+    s += QString("Group search: %1 adjacency visits\n").arg(groupVisits);
+    s += QString("Group sizes:");
+    for (uint i = 0; i < PERF_GROUP_BINS; i++)
+    {
+        const uint lo = i ? (1u << (i - 1)) + 1 : 1, hi = 1u << i;
+        const QString range = (i == PERF_GROUP_BINS - 1) ? QString("%1+").arg(lo) : (lo == hi) ? QString::number(lo) : QString("%1-%2").arg(lo).arg(hi);
+        s += QString(" %1:%2%").arg(range, avg(groupSizes[i] * 100, groups));
+    }
+    return s;
+#else
+    return "Performance counters are not compiled in (build with the CMake option Z80_PERF_COUNTERS)";
+#endif
+}
+
+//=============================================================================
+// CHECKPOINTS AND REWIND
+//=============================================================================
+
+// Per net: bit 0 is the state, bit 1 pulled high, bit 2 pulled low; per transistor: on-state
+void ClassSimZ80_AVX2::saveNets(QVector<uint8_t> &nets, QVector<uint8_t> &trans)
+{
+    nets.resize(MAX_NETS);
+    for (net_t n = 0; n < MAX_NETS; n++)
+        nets[n] = testBit(m_netState, n) | (testBit(m_netHigh, n) << 1) | (testBit(m_netLow, n) << 2);
+    trans.resize(MAX_TRANS);
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+        trans[t] = testBit(m_transOn, t);
+}
+
+// Restores the saved net and transistor states, along with the group cache keys that derive from them
+// The group cache entries stay valid, since each one is fully determined by its key
+void ClassSimZ80_AVX2::restoreNets(const uint8_t *nets, const uint8_t *trans)
+{
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        if (m_training)
+            m_netChanged[n] |= testBit(m_netState, n) != (nets[n] & 1);
+        writeBit(m_netState, n, nets[n] & 1);
+        writeBit(m_netHigh, n, nets[n] & 2);
+        writeBit(m_netLow, n, nets[n] & 4);
+    }
+    m_loopEvents++;
+    memset(m_netGen, 0xFF, sizeof(m_netGen)); // No group is known to be valid in the restored state
+    memset(m_cccOn, 0, sizeof(m_cccOn));
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+    {
+        writeBit(m_transOn, t, trans[t]);
+        if (trans[t])
+            m_cccOn[m_transCcc[t]] ^= m_transCccBit[t];
+    }
+    for (net_t n = npwr + 1; n < MAX_NETS; n++)
+        updatePull(n);
+}
+
+/*
+ * Takes a checkpoint of the chip and of the simulated environment (RAM, IO and the trickbox) at the current half-cycle
+ * When the list is full, every other checkpoint is dropped and the interval doubles, so the checkpoints always
+ * reach back to the reset, and the rewind re-simulates at most one interval
+ */
+void ClassSimZ80_AVX2::takeCheckpoint()
+{
+    SimCheckpoint cp;
+    cp.hcycle = m_hcycletotal;
+    saveNets(cp.nets, cp.trans);
+    cp.env = ::controller.getTrickbox().saveState();
+    m_checkpoints.push_back(std::move(cp));
+    if (m_checkpoints.size() >= CHECKPOINT_MAX)
+    {
+        for (size_t i = 1; i < m_checkpoints.size() / 2; i++)
+            m_checkpoints[i] = std::move(m_checkpoints[i * 2]);
+        m_checkpoints.resize(m_checkpoints.size() / 2);
+        m_checkpointInterval *= 2;
+    }
+    m_nextCheckpoint = m_checkpoints.back().hcycle + m_checkpointInterval;
+}
+
+/*
+ * Rewinds the simulation to the given half-cycle: restores the nearest checkpoint before it and runs the remainder
+ * Returns false if the simulation is running or there is no checkpoint to rewind from (before the first reset)
+ */
+bool ClassSimZ80_AVX2::rewind(uint hcycle)
+{
+    if (m_runcount)
+        return false;
+    const uint current = m_hcycletotal;
+    if (hcycle >= current)
+    {
+        doRunsim(hcycle - current);
+        return true;
+    }
+    auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), hcycle,
+                               [](uint h, const SimCheckpoint &cp) { return h < cp.hcycle; });
+    if (it == m_checkpoints.begin())
+        return false;
+    m_checkpoints.erase(it, m_checkpoints.end()); // The checkpoints past the rewind point are no longer valid
+    const SimCheckpoint &cp = m_checkpoints.back();
+    restoreNets(cp.nets.constData(), cp.trans.constData());
+    ::controller.getTrickbox().restoreState(cp.env);
+    m_hcycletotal = cp.hcycle;
+    m_nextCheckpoint = cp.hcycle + m_checkpointInterval;
+    qInfo() << "Rewinding from the checkpoint at hcycle" << cp.hcycle;
+    if (hcycle > cp.hcycle)
+        doRunsim(hcycle - cp.hcycle);
+    else
+        emit ::controller.onRunStopped(m_hcycletotal);
+    return true;
+}
+
+// State file: a header, the per-net flags and the per-transistor on-states in the checkpoint layout, so that loading
+// copies them straight from the mapped file, and the compressed simulated environment
+#define STATE_MAGIC   0x5A383053 // "Z80S"
+#define STATE_VERSION 1
+struct StateFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t maxNets;                   // Netlist size the state was saved with
+    uint32_t maxTrans;
+    uint32_t hcycle;                    // Half-cycle of the state
+    uint32_t envSize;                   // Size of the compressed RAM, IO and trickbox state
+};
+
+/*
+ * Saves the complete simulation state into a file: the chip, the current half-cycle, and the RAM, IO and trickbox
+ */
+bool ClassSimZ80_AVX2::saveState(const QString &fileName)
+{
+    if (m_runcount)
+    {
+        qWarning() << "Stop the simulation before saving its state";
+        return false;
+    }
+    QVector<uint8_t> nets, trans;
+    saveNets(nets, trans);
+    const QByteArray env = ::controller.getTrickbox().saveState();
+    const StateFileHeader header { STATE_MAGIC, STATE_VERSION, MAX_NETS, MAX_TRANS, uint32_t(m_hcycletotal), uint32_t(env.size()) };
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Unable to write" << fileName;
+        return false;
+    }
+    bool ok = file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == sizeof(header);
+    ok = ok && (file.write(reinterpret_cast<const char *>(nets.constData()), MAX_NETS) == MAX_NETS);
+    ok = ok && (file.write(reinterpret_cast<const char *>(trans.constData()), MAX_TRANS) == MAX_TRANS);
+    ok = ok && (file.write(env) == env.size());
+    if (ok)
+        qInfo() << "Saved the simulation state at hcycle" << header.hcycle << "to" << fileName;
+    else
+        qWarning() << "Error writing" << fileName;
+    return ok;
+}
+
+/*
+ * Loads the simulation state from a file; the simulation continues from the half-cycle it was saved at
+ * The file is mapped into memory and the net and transistor states are copied from it
+ */
+bool ClassSimZ80_AVX2::loadState(const QString &fileName)
+{
+    if (m_runcount)
+    {
+        qWarning() << "Stop the simulation before loading a state";
+        return false;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Unable to open" << fileName;
+        return false;
+    }
+    const qint64 size = file.size();
+    const uchar *data = (size >= qint64(sizeof(StateFileHeader))) ? file.map(0, size) : nullptr;
+    StateFileHeader header {};
+    if (data)
+        memcpy(&header, data, sizeof(header));
+    if (!data || (header.magic != STATE_MAGIC) || (header.version != STATE_VERSION) || (header.maxNets != MAX_NETS) ||
+        (header.maxTrans != MAX_TRANS) || (size != qint64(sizeof(header) + MAX_NETS + MAX_TRANS + header.envSize)))
+    {
+        qWarning() << fileName << "is not a simulation state file of this netlist";
+        return false;
+    }
+    const uint8_t *nets = data + sizeof(header);
+    restoreNets(nets, nets + MAX_NETS);
+    ::controller.getTrickbox().restoreState(QByteArray(reinterpret_cast<const char *>(nets + MAX_NETS + MAX_TRANS), header.envSize));
+    file.unmap(const_cast<uchar *>(data));
+
+    m_hcycletotal = header.hcycle;
+    m_checkpoints.clear();
+    m_checkpointInterval = CHECKPOINT_INTERVAL;
+    takeCheckpoint();
+    qInfo() << "Loaded the simulation state at hcycle" << header.hcycle << "from" << fileName;
+    emit ::controller.onRunStopped(m_hcycletotal);
+    return true;
+}
+
+//=============================================================================
+// FAST-FORWARD
+//=============================================================================
+
+/*
+ * Fast-forwards the program from the reset to a half-cycle, or to where the PC first reaches an address (if not -1),
+ * on the instruction-level emulator, then hydrates the netlist with the emulated state and continues from there
+ * The netlist executes a loader program from the reset, read in place of the RAM at address 0: it loads all registers,
+ * the interrupt mode and enable, and jumps to the PC. Loading the registers by instructions keeps the register exchange
+ * flip-flops consistent with them, which setting the register latch nets could not. The half-cycle count continues
+ * from the emulated T-states. Returns false if the hydrated registers differ from the emulated ones.
+ * The emulator does not drive the interrupt, wait or bus request pins, and ignores the trickbox pin controls.
+ */
+bool ClassSimZ80_AVX2::fastForward(uint hcycles, int pc)
+{
+    if (m_runcount)
+    {
+        qWarning() << "Stop the simulation before fast-forwarding it";
+        return false;
+    }
+    doReset();
+    while (!isOpcodeFetch()) // The reset sequence ends a few half-cycles before the first opcode fetch
+        halfCycle();
+    const uint fetch0 = m_hcycletotal;
+
+    // The emulator starts from the registers that the netlist has after the reset (most are undefined)
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const ClassSimZ80_Emu &e = m_emu;
+    z80state z {};
+    readRegisters(z);
+    z.pc = 0;
+    m_emu.reset();
+    m_emu.setState(z);
+    m_emu.run((hcycles > fetch0) ? ((quint64(hcycles) - fetch0 + 1) / 2) : 0, pc);
+    const qint64 ms = elapsed.elapsed();
+
+    // R is loaded 4 instructions before the jump, each of which increments it
+    const uint8_t r = ((e.r - 4) & 0x7F) | (e.r & 0x80);
+    static const uint8_t im[3] = { 0x46, 0x56, 0x5E };
+    const uint8_t loader[] = {
+        0x31, 0x00, 0x00,               // LD SP,data (patched below)
+        0xF1, 0x08,                     // POP AF; EX AF,AF'
+        0x01, e.c2, e.b2, 0x11, e.e2, e.d2, 0x21, e.l2, e.h2, // LD BC,nn; LD DE,nn; LD HL,nn
+        0xD9,                           // EXX
+        0x01, e.c, e.b, 0x11, e.e, e.d, 0x21, e.l, e.h,
+        0xDD, 0x21, uint8_t(e.ix), uint8_t(e.ix >> 8), // LD IX,nn
+        0xFD, 0x21, uint8_t(e.iy), uint8_t(e.iy >> 8), // LD IY,nn
+        0xED, im[e.im],                 // IM n
+        0x3E, e.i, 0xED, 0x47,          // LD A,n; LD I,A
+        0x3E, r, 0xED, 0x4F,            // LD A,n; LD R,A
+        0xF1,                           // POP AF
+        0x31, uint8_t(e.sp), uint8_t(e.sp >> 8), // LD SP,nn
+        uint8_t(e.iff1 ? 0xFB : 0x00),  // EI or NOP
+        0xC3, uint8_t(e.pc), uint8_t(e.pc >> 8), // JP nn
+    };
+    const uint8_t data[] = { e.f2, e.a2, e.f, e.a };
+    m_loader = QByteArray(reinterpret_cast<const char *>(loader), sizeof(loader));
+    m_loader.append(reinterpret_cast<const char *>(data), sizeof(data));
+    m_loader[1] = char(sizeof(loader));
+    m_loaderLast = sizeof(loader) - 1;
+    for (uint i = 0; (i < 1000) && (!m_loader.isEmpty() || !isOpcodeFetch()); i++)
+        halfCycle();
+    const bool loaded = m_loader.isEmpty();
+    m_loader.clear();
+
+    m_hcycletotal = fetch0 + uint(e.tstates * 2);
+    m_checkpoints.clear();
+    m_checkpointInterval = CHECKPOINT_INTERVAL;
+    takeCheckpoint();
+
+    // The jump leaves the target address in WZ, which the emulated program may not have
+    z80state ez {};
+    readRegisters(z);
+    m_emu.readState(ez);
+    const bool ok = loaded && (z.ab == ez.pc) && (z.af == ez.af) && (z.bc == ez.bc) && (z.de == ez.de) && (z.hl == ez.hl) &&
+        (z.af2 == ez.af2) && (z.bc2 == ez.bc2) && (z.de2 == ez.de2) && (z.hl2 == ez.hl2) &&
+        (z.ix == ez.ix) && (z.iy == ez.iy) && (z.sp == ez.sp) && (z.ir == ez.ir);
+
+    qInfo() << "Fast-forwarded" << e.tstates << "T-states in" << ms << "ms to hcycle" << uint(m_hcycletotal)
+            << "PC" << QString::number(e.pc, 16).toUpper() << (e.halted ? "(halted)" : e.stopped ? "(stopped by the trickbox)" : "");
+    if (!ok)
+        qWarning().noquote() << "The netlist state differs from the emulated one:\n" << z80state::dumpState(z)
+                             << "Emulated:\n" << z80state::dumpState(ez);
+    emit ::controller.onRunStopped(m_hcycletotal);
+    return ok;
+}
+
+// Same condition as the opcode read of halfCycle(): the next half-cycle reads the opcode
+bool ClassSimZ80_AVX2::isOpcodeFetch()
+{
+    return !readBit(nclk) && readBit(n_rfsh) && !readBit(n_m1) && !readBit(n_mreq) && !readBit(n_rd) &&
+           readBit(n_wr) && readBit(n_iorq) && readBit(n_t2);
+}
+
+// Reads the chip state with the registers that the program sees: the exchange flip-flops of EX AF,AF', EXX and
+// EX DE,HL select the physical registers that hold AF, BC, DE and HL
+void ClassSimZ80_AVX2::readRegisters(z80state &z)
+{
+    readState(z);
+    if (!readBit("ex_dehl1")) // DE and HL of the first register bank are exchanged
+        std::swap(z.de, z.hl);
+    if (!readBit("ex_dehl0")) // DE and HL of the second register bank are exchanged
+        std::swap(z.de2, z.hl2);
+    if (!readBit("ex_bcdehl")) // The second register bank is the main one
+    {
+        std::swap(z.bc, z.bc2);
+        std::swap(z.de, z.de2);
+        std::swap(z.hl, z.hl2);
+    }
+    if (!readBit("ex_af"))
+        std::swap(z.af, z.af2);
+}
+
+//=============================================================================
+// LOCKSTEP VALIDATION
+//=============================================================================
+
+/*
+ * Runs the simulation for a number of half-cycles, or until the trickbox stops it, in lockstep with the reference
+ * simulator, which starts from the current chip state and follows each half-cycle. Every "every" half-cycles, and at
+ * the end, compares the states of all nets and transistors of the two. Returns false at the first divergence, which it
+ * reports with the half-cycle and the differing nets; with a sampling interval, the divergence happened after the
+ * last matching half-cycle that it also reports.
+ * This simulator is the leader: it does the memory and IO writes, and the trickbox pin controls, for both of them.
+ */
+bool ClassSimZ80_AVX2::lockstep(ClassSimZ80 &ref, uint hcycles, uint every)
+{
+    if (m_runcount)
+        return false;
+    const static QStringList pins = { "_int", "_nmi", "_busrq", "_wait", "_reset" };
+    net_t pinNets[5];
+    for (int i = 0; i < 5; i++)
+        pinNets[i] = get(pins[i]);
+    every = qMax(every, 1u);
+
+    QVector<uint8_t> nets, trans;
+    saveNets(nets, trans);
+    ref.setNetStates(nets.constData(), trans.constData(), m_hcycletotal);
+
+    emit ::controller.onRunStarting(hcycles);
+    QElapsedTimer elapsed;
+    elapsed.start();
+    uint matched = m_hcycletotal, count = 0;
+    bool ok = true;
+    const bool loopSkip = m_loopSkip; // The follower runs every half-cycle
+    m_loopSkip = false;
+    m_runcount = hcycles;
+    while (ok && (m_runcount.fetchAndAddOrdered(-1) > 0))
+    {
+        ref.stepFollower();
+        halfCycle();
+        uint pinValues = 0; // The trickbox sets the pins of the leader after its half-cycle, all at once
+        for (int i = 0; i < 5; i++)
+            pinValues |= uint(testBit(m_netHigh, pinNets[i])) << i;
+        ref.setPins(0x1F, pinValues);
+        if ((++count % every == 0) || (m_runcount <= 0))
         {
-            net_t c1 = m_transC1[t0];
-            net_t c2 = m_transC2[t0];
-            net_t other = (c1 == n) ? c2 : ((c2 == n) ? c1 : 0);
-            if (other) addNetToGroup(other);
+            QStringList diff;
+            for (net_t n = 0; n < MAX_NETS; n++)
+            {
+                if (testBit(m_netState, n) != ref.getNetState(n))
+                    diff.append((m_netnames[n].isEmpty() ? QString::number(n) : m_netnames[n]) % '=' % QString::number(testBit(m_netState, n)));
+            }
+            uint transDiff = 0;
+            for (tran_t t = 0; t < MAX_TRANS; t++)
+                transDiff += m_transGate[t] && (testBit(m_transOn, t) != ref.isTransOn(t));
+            if (diff.count() || transDiff)
+            {
+                qWarning() << "Lockstep: the simulators diverged at hcycle" << m_hcycletotal << "after matching at hcycle" << matched;
+                qWarning() << diff.count() << "nets and" << transDiff << "transistors differ; the nets of the optimized simulator:";
+                qWarning() << qPrintable(diff.mid(0, 64).join(' '));
+                ok = false;
+            }
+            else
+                matched = m_hcycletotal;
         }
+    }
+    m_runcount = 0;
+    m_loopSkip = loopSkip;
+    if (ok)
+        qInfo() << "Lockstep: the simulators matched for" << count << "half-cycles, compared every" << every << "in" << elapsed.elapsed() << "ms";
+    emit ::controller.onRunStopped(m_hcycletotal);
+    return ok;
+}
+
+//=============================================================================
+// STEADY-STATE LOOP SKIPPING
+//=============================================================================
+
+/*
+ * Called at every opcode fetch of a running simulation, before the opcode is read. At a loop head, compares the chip
+ * with the snapshot taken there; if it repeats, with no memory or IO writes, trickbox reads or pin changes since, the
+ * chip runs the same period over and over, and the half-cycle count jumps ahead by whole periods, up to the end of the
+ * run and the next stop or pin event that the trickbox has scheduled, at most LOOP_MAX_SKIP half-cycles at a time. The nets are the complete chip state, since
+ * the transistors follow their gates. It does not skip while recording a trace or the watch, or loading registers.
+ */
+void ClassSimZ80_AVX2::skipLoop(uint16_t pc)
+{
+    const bool head = pc <= m_lastFetch;
+    m_lastFetch = pc;
+    if (!head || !m_loopSkip || (m_runcount <= 0) || m_trace || !m_loader.isEmpty() || ::controller.getWatch().getWatchlistLen())
+        return;
+
+    // The RAM and IO space can also change by the scripts and the GUI, from another thread
+    const uint events = m_loopEvents + ::controller.getTrickbox().getWrites();
+    SimLoopHead &e = m_loopHeads[pc % LOOP_HEADS];
+    if ((e.pc != pc) || (e.events != events) || e.nets.isEmpty() || (++e.visits > LOOP_MAX_VISITS))
+    {
+        e.pc = pc;
+        e.hcycle = m_hcycletotal;
+        e.events = events;
+        e.visits = 0;
+        e.nets.resize(3 * NET_WORDS);
+        memcpy(e.nets.data(), m_netState, sizeof(m_netState));
+        memcpy(e.nets.data() + NET_WORDS, m_netHigh, sizeof(m_netHigh));
+        memcpy(e.nets.data() + 2 * NET_WORDS, m_netLow, sizeof(m_netLow));
+        return;
+    }
+    if (memcmp(e.nets.constData(), m_netState, sizeof(m_netState)) || memcmp(e.nets.constData() + NET_WORDS, m_netHigh, sizeof(m_netHigh)) ||
+        memcmp(e.nets.constData() + 2 * NET_WORDS, m_netLow, sizeof(m_netLow)))
+        return;
+
+    // A long run, such as run(0), skips in bounded steps, and the half-cycle count does not pass INT_MAX
+    const uint hcycle = m_hcycletotal;
+    const uint period = hcycle - e.hcycle;
+    const uint room = qMin(qMin(uint(m_runcount), uint(LOOP_MAX_SKIP)),
+                           qMin(::controller.getTrickbox().nextEvent(hcycle) - hcycle, uint(INT_MAX) - qMin(hcycle, uint(INT_MAX))));
+    const uint skip = room - room % period;
+    e.hcycle = hcycle + skip;
+    e.visits = 0;
+    if (!skip)
+        return;
+    m_runcount.fetchAndAddOrdered(-int(skip));
+    m_hcyclecnt.fetchAndAddRelaxed(skip);
+    m_hcycletotal.fetchAndAddRelaxed(skip);
+    m_hcyclesSkipped += skip;
+}
+
+//=============================================================================
+// CONSTANT-NET FOLDING
+//=============================================================================
+
+/*
+ * Starts observing which nets change their state, before the reset: the nets that do not change during the reset and
+ * a representative run (a training run) are saved as the observed constants by saveConstants()
+ */
+void ClassSimZ80_AVX2::startTraining()
+{
+    memset(m_netChanged, 0, sizeof(m_netChanged));
+    m_training = true;
+}
+
+// Returns the nets that the simulation sets directly: the input pins and the data bus
+QVector<bool> ClassSimZ80_AVX2::getInputNets()
+{
+    QVector<bool> input(MAX_NETS, false);
+    for (auto name : { "_int", "_nmi", "_busrq", "_wait", "_reset", "clk" })
+        input[get(name)] = true;
+    for (int i = 0; i < 8; i++)
+        input[n_db[i]] = true;
+    return input;
+}
+
+/*
+ * Proves the constant nets from the netlist alone: the value of each net, or -1 if it can change
+ * A transistor whose gate is constant is always on or always off. A net whose transistors are all always off, or
+ * always on to one power net, resolves to that power net, or to its pull-up; the inputs can change at any time.
+ */
+QVector<int8_t> ClassSimZ80_AVX2::proveConstants()
+{
+    QVector<int8_t> value(MAX_NETS, -1);
+    value[ngnd] = 0;
+    value[npwr] = 1;
+    const QVector<bool> input = getInputNets();
 
-        // Process transistor 1
-        if (m_transOn[t1])
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (net_t n = npwr + 1; n < MAX_NETS; n++)
         {
-            net_t c1 = m_transC1[t1];
-            net_t c2 = m_transC2[t1];
-            net_t other = (c1 == n) ? c2 : ((c2 == n) ? c1 : 0);
-            if (other) addNetToGroup(other);
+            if ((value[n] >= 0) || input[n])
+                continue;
+            bool low = false, high = false, open = false;
+            for (uint i = 0; (i < m_netlist[n].c1c2sCount) && !open; i++)
+            {
+                const NetEdge &e = m_netlist[n].c1c2s[i];
+                const int8_t gate = value[m_transGate[e.t]];
+                if ((gate == 0) || (e.other == n))
+                    continue;
+                low |= (gate == 1) && (e.other == ngnd);
+                high |= (gate == 1) && (e.other == npwr);
+                open = (gate < 0) || (e.other > npwr);
+            }
+            if (open || (low && high) || (!low && !high && !m_netlist[n].hasPullup))
+                continue;
+            value[n] = !low;
+            changed = true;
         }
+    }
+    return value;
+}
+
+/*
+ * Saves the constant nets into a text file, one per line: the net number, its value and how it was found. The nets
+ * that did not change since startTraining() are added as observed; they are constant only for the programs and the
+ * pin activity like that of the training run. Without a training run, only the proven constants are saved.
+ */
+bool ClassSimZ80_AVX2::saveConstants(const QString &fileName)
+{
+    const QVector<int8_t> proven = proveConstants();
+    const QVector<bool> input = getInputNets();
 
-        // Process transistor 2
-        if (m_transOn[t2])
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        qWarning() << "Unable to write" << fileName;
+        return false;
+    }
+    QTextStream out(&file);
+    out << "# Constant nets of the Z80 netlist: net number, value, proven or observed\n";
+    out << "# The simulator leaves out the transistors that the constant low nets keep off\n";
+    uint countProven = 0, countObserved = 0;
+    for (net_t n = npwr + 1; n < MAX_NETS; n++)
+    {
+        if (proven[n] >= 0)
+        {
+            out << n << "," << proven[n] << ",proven\n";
+            countProven++;
+        }
+        else if (m_training && !m_netChanged[n] && !input[n] && !isNetOrphan(n))
         {
-            net_t c1 = m_transC1[t2];
-            net_t c2 = m_transC2[t2];
-            net_t other = (c1 == n) ? c2 : ((c2 == n) ? c1 : 0);
-            if (other) addNetToGroup(other);
+            out << n << "," << int(testBit(m_netState, n)) << ",observed\n";
+            countObserved++;
         }
+    }
+    m_training = false;
+    qInfo() << "Saved" << countProven << "proven and" << countObserved << "observed constant nets to" << fileName;
+    return true;
+}
 
-        // Process transistor 3
-        if (m_transOn[t3])
+/*
+ * Loads the constant nets that saveConstants() found and reduces the netlist: the transistors gated by a constant
+ * low net are always off, so they are taken out of the adjacency, where the group search would only skip them, and
+ * out of the components, which split into smaller ones that resolve faster and more often fit the group cache.
+ * The gate lists stay; a net's gate count decides the value of a floating group. Call it before the reset.
+ * The observed constants are folded only if requested: they held in the training run, but another run may change
+ * them, which stops the simulation (see stopFolded()).
+ */
+bool ClassSimZ80_AVX2::loadConstants(const QString &fileName, bool observed)
+{
+    if (m_runcount)
+    {
+        qWarning() << "Stop the simulation before loading the constant nets";
+        return false;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qWarning() << "Unable to open" << fileName;
+        return false;
+    }
+    QVector<int8_t> value(MAX_NETS, -1);
+    uint count = 0, skipped = 0;
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        const QStringList list = line.split(',');
+        bool ok1 = false, ok2 = false;
+        const uint n = (list.count() == 3) ? list[0].toUInt(&ok1) : 0;
+        const uint v = (list.count() == 3) ? list[1].toUInt(&ok2) : 0;
+        const QString kind = (list.count() == 3) ? list[2].trimmed() : QString();
+        if (!ok1 || !ok2 || (n <= npwr) || (n >= MAX_NETS) || (v > 1) || ((kind != "proven") && (kind != "observed")))
         {
-            net_t c1 = m_transC1[t3];
-            net_t c2 = m_transC2[t3];
-            net_t other = (c1 == n) ? c2 : ((c2 == n) ? c1 : 0);
-            if (other) addNetToGroup(other);
+            qWarning() << fileName << "is not a constant nets file of this netlist:" << line;
+            return false;
+        }
+        if ((kind == "observed") && !observed)
+        {
+            skipped++;
+            continue;
         }
+        value[n] = int8_t(v);
+        count++;
     }
 
-    // Handle remaining elements
-    for (; i < count; i++)
+    uint on = 0;
+    for (tran_t t = 0; t < MAX_TRANS; t++)
     {
-        tran_t t = c1c2s[i];
-        if (!m_transOn[t]) continue;
+        if (!m_transGate[t] || m_transFolded[t] || (value[m_transGate[t]] < 0))
+            continue;
+        if (value[m_transGate[t]])
+            on++;
+        else
+        {
+            m_transFolded[t] = 1;
+            m_transFoldedCount++;
+            m_netFolded[m_transGate[t]] = 1;
+        }
+    }
+    size_t edges = 0;
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        NetAVX2 &net = m_netlist[n];
+        uint16_t kept = 0;
+        for (uint16_t i = 0; i < net.c1c2sCount; i++)
+        {
+            if (!m_transFolded[net.c1c2s[i].t])
+                net.c1c2s[kept++] = net.c1c2s[i];
+        }
+        net.c1c2sCount = kept;
+        edges += kept;
+    }
+    buildComponents();
+    buildGates();
+    qInfo() << "Folded" << count << "constant nets from" << fileName << ":" << m_transFoldedCount << "transistors always off,"
+            << on << "always on; adjacency:" << edges << "of" << m_adjPoolSize << "entries";
+    if (skipped)
+        qInfo() << "Not folded:" << skipped << "observed constant nets, which do not hold in every run";
+    return true;
+}
+
+/*
+ * Stops the simulation after a net that gates folded transistors changed its state: the constant nets were observed
+ * in a run unlike this one, and the transistors that the net should have switched on stay off. The netlist has to be
+ * loaded again, without the observed constants, to simulate this run.
+ */
+void ClassSimZ80_AVX2::stopFolded()
+{
+    if (m_runcount)
+        qWarning() << "The reduced netlist cannot simulate this run: folded constant net" << m_foldedChange.load()
+                   << "changed its state at half-cycle" << uint(m_hcycletotal);
+    m_runcount = 0;
+}
+
+//=============================================================================
+// TRACE RECORDING AND REPLAY
+//=============================================================================
+
+/*
+ * Selects the kernels of an instruction set level, if this CPU supports it
+ */
+bool ClassSimZ80_AVX2::setIsa(SimIsa isa)
+{
+    if (isa > detectIsa())
+        return false;
+    selectKernels(isa);
+    return true;
+}
+
+/*
+ * Starts recording a trace: takes a snapshot of the chip state, and records every input net set from now on
+ */
+void ClassSimZ80_AVX2::startRecording()
+{
+    delete m_trace;
+    m_trace = new SimTrace;
+    saveNets(m_trace->nets, m_trace->trans);
+}
 
-        net_t c1 = m_transC1[t];
-        net_t c2 = m_transC2[t];
-        net_t other = (c1 == n) ? c2 : ((c2 == n) ? c1 : 0);
-        if (other)
-            addNetToGroup(other);
+/*
+ * Stops the recording and returns the trace, along with the hash of the state it leads to
+ */
+SimTrace ClassSimZ80_AVX2::stopRecording()
+{
+    SimTrace trace;
+    if (m_trace)
+    {
+        trace = *m_trace;
+        trace.hash = getStateHash();
+        delete m_trace;
+        m_trace = nullptr;
     }
+    return trace;
 }
 
-__forceinline void ClassSimZ80_AVX2::addRecalcNet(net_t n)
+quint64 ClassSimZ80_AVX2::getStateHash()
 {
-    if (n <= npwr) return;
+    quint64 hash = 0xCBF29CE484222325ULL; // FNV-1a
+    for (net_t n = 0; n < MAX_NETS; n++)
+        hash = (hash ^ testBit(m_netState, n)) * 0x100000001B3ULL;
+    return hash;
+}
 
-    // O(1) duplicate check - inlined for zero call overhead
-    const uint64_t mask = 1ULL << (n & 63);
-    uint64_t& word = m_recalcBitset[n >> 6];
-    if (word & mask)
-        return;
+const char *ClassSimZ80_AVX2::kernelName(SimKernel kernel)
+{
+    switch (kernel)
+    {
+        case SimKernel::RecalcNetlist: return "recalcNetlist";
+        case SimKernel::RecalcNet: return "recalcNet";
+        case SimKernel::GroupSearch: return "getNetGroup";
+        case SimKernel::NetValue: return "getNetValue";
+    }
+    return "";
+}
 
-    word |= mask;
-    m_recalcList[m_recalcListIndex++] = n;
+// Puts the chip into the state that the trace was recorded from; the group cache starts empty
+void ClassSimZ80_AVX2::restoreTrace(const SimTrace &trace)
+{
+    restoreNets(trace.nets.constData(), trace.trans.constData());
+    memset(m_groupCache, 0, sizeof(GroupCacheEntry) << GROUP_CACHE_BITS);
 }
 
-void ClassSimZ80_AVX2::allNets()
+/*
+ * Replays a trace from its starting state and times one kernel
+ * The inputs are applied the same way as set() applies them, batches included, so every kernel runs on the same sequence
+ * of waves.
+ * The replay leaves the chip in the final state of the trace; the result tells if it matches the recorded one.
+ */
+SimKernelStats ClassSimZ80_AVX2::replay(const SimTrace &trace, SimKernel kernel)
 {
+    typedef std::chrono::steady_clock clock;
+    SimKernelStats stats;
+    if ((trace.nets.count() != MAX_NETS) || (trace.trans.count() != MAX_TRANS) || m_runcount)
+        return stats;
+    restoreTrace(trace);
     m_listIndex = 0;
-    for (net_t n = 0; n < MAX_NETS; n++)
+    for (int i = 0; i < trace.inputs.count(); i++)
     {
-        if (n == ngnd || n == npwr)
+        const SimTrace::Input &in = trace.inputs[i];
+        setPull(in.n, in.on);
+        m_list[m_listIndex++] = in.n;
+        if ((i + 1 < trace.inputs.count()) && trace.inputs[i + 1].batched) // The next input joins the same recalculation
             continue;
-        if (m_netlist[n].gatesCount == 0 && m_netlist[n].c1c2sCount == 0)
-            continue;
-        m_list[m_listIndex++] = n;
+        if (kernel == SimKernel::RecalcNetlist)
+        {
+            const clock::time_point start = clock::now();
+            recalcNetlist();
+            stats.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+            stats.calls++;
+        }
+        else
+            replayNetlist(kernel, stats);
+    }
+    stats.exact = getStateHash() == trace.hash;
+    return stats;
+}
+
+// Same as the serial recalcNetlist(), timing the per-net kernel over every wave
+void ClassSimZ80_AVX2::replayNetlist(SimKernel kernel, SimKernelStats &stats)
+{
+    typedef std::chrono::steady_clock clock;
+    m_recalcListIndex = 0;
+    clearBitset(m_recalcBitset);
+
+    while (m_listIndex)
+    {
+        stats.waves++;
+        clock::time_point start;
+        if (kernel == SimKernel::GroupSearch)
+        {
+            start = clock::now();
+            for (int i = 0; i < m_listIndex; i++)
+            {
+                if (m_list[i] <= npwr)
+                    continue;
+                getNetGroup(m_list[i]);
+                stats.sink += m_groupIndex;
+                stats.calls++;
+            }
+            stats.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        }
+        else if (kernel == SimKernel::NetValue)
+        {
+            // Resolve the groups of the wave first, so that only their values are timed
+            m_replayGroups.clear();
+            m_replayGroupStart.clear();
+            for (int i = 0; i < m_listIndex; i++)
+            {
+                if (m_list[i] <= npwr)
+                    continue;
+                getNetGroup(m_list[i]);
+                m_replayGroupStart.push_back(uint(m_replayGroups.size()));
+                m_replayGroups.insert(m_replayGroups.end(), m_group, m_group + m_groupIndex);
+            }
+            m_replayGroupStart.push_back(uint(m_replayGroups.size()));
+            const net_t *groups = m_replayGroups.data();
+            start = clock::now();
+            for (size_t i = 0; i + 1 < m_replayGroupStart.size(); i++)
+                stats.sink += getNetValue(groups + m_replayGroupStart[i], m_replayGroupStart[i + 1] - m_replayGroupStart[i]);
+            stats.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+            stats.calls += m_replayGroupStart.size() - 1;
+        }
+
+        start = clock::now();
+        runSerialWave<NetlistTopology>();
+        if (kernel == SimKernel::RecalcNet)
+        {
+            stats.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+            stats.calls += m_listIndex;
+        }
+
+        memcpy(m_list, m_recalcList, m_recalcListIndex * sizeof(net_t));
+        m_listIndex = m_recalcListIndex;
+        m_recalcListIndex = 0;
+        clearBitset(m_recalcBitset);
+    }
+}
+
+// Trace file: a header with the netlist size, then the snapshot and the inputs
+#define TRACE_MAGIC   0x5A383054 // "Z80T"
+#define TRACE_VERSION 2
+
+bool SimTrace::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Unable to write" << fileName;
+        return false;
+    }
+    QDataStream out(&file);
+    out << quint32(TRACE_MAGIC) << quint32(TRACE_VERSION) << quint32(MAX_NETS) << quint32(MAX_TRANS);
+    out << nets << trans << hcycles << hash;
+    out << quint32(inputs.count());
+    for (const Input &in : inputs)
+        out << quint16(in.n) << in.on << in.batched;
+    return out.status() == QDataStream::Ok;
+}
+
+bool SimTrace::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Unable to open" << fileName;
+        return false;
     }
+    QDataStream in(&file);
+    quint32 magic, version, maxNets, maxTrans, count;
+    in >> magic >> version >> maxNets >> maxTrans;
+    if ((magic != TRACE_MAGIC) || (version != TRACE_VERSION) || (maxNets != MAX_NETS) || (maxTrans != MAX_TRANS))
+    {
+        qWarning() << fileName << "is not a trace of this netlist";
+        return false;
+    }
+    in >> nets >> trans >> hcycles >> hash >> count;
+    inputs.resize(count);
+    for (Input &input : inputs)
+    {
+        quint16 n;
+        in >> n >> input.on >> input.batched;
+        input.n = n;
+    }
+    return (in.status() == QDataStream::Ok) && (nets.count() == MAX_NETS) && (trans.count() == MAX_TRANS);
 }
 
 //=============================================================================
 // DATA BUS AND PIN OPERATIONS
 //=============================================================================
 
-__forceinline void ClassSimZ80_AVX2::set(bool on, const QString &name)
+void ClassSimZ80_AVX2::set(bool on, const QString &name)
 {
-    net_t n = get(name);
-    if (m_netlist[n].isHigh == on)
-        return;
-    m_netlist[n].isHigh = on;
-    m_netlist[n].isLow = !on;
-
-    m_list[0] = n;
-    m_listIndex = 1;
-    recalcNetlist();
+    set(on, get(name));
 }
 
-// Fast version using pre-cached net_t - avoids QString hash lookup
-__forceinline void ClassSimZ80_AVX2::set(bool on, net_t n)
+/*
+ * Pulls the input nets high or low, bit i of the values for nets[i], and settles those that changed in a single
+ * netlist recalculation: their first wave holds all of them, instead of one full recalculation per net
+ * The nets must be distinct
+ */
+void ClassSimZ80_AVX2::set(const net_t *nets, uint values, uint count)
 {
-    if (m_netlist[n].isHigh == on)
-        return;
-    m_netlist[n].isHigh = on;
-    m_netlist[n].isLow = !on;
-
-    m_list[0] = n;
-    m_listIndex = 1;
-    recalcNetlist();
+    m_listIndex = 0;
+    for (uint i = 0; i < count; i++)
+    {
+        const net_t n = nets[i];
+        const bool on = (values >> i) & 1;
+        if (testBit(m_netHigh, n) == on)
+            continue;
+        if (Q_UNLIKELY(m_trace))
+            m_trace->inputs.append({ n, on, m_listIndex > 0 });
+        setPull(n, on);
+        m_list[m_listIndex++] = n;
+    }
+    if (m_listIndex)
+        recalcNetlist();
 }
 
 void ClassSimZ80_AVX2::setDB(uint8_t db)
 {
-    // Use cached net_t array instead of QString lookups
-    for (int i = 0; i < 8; i++)
-        set(db & (1 << i), n_db[i]);
+    SIM_PERF(const quint64 recalcs = m_perf.netlistRecalcs);
+    set(n_db, db, 8); // All eight bits settle together
+    SIM_PERF(m_perf.setDBRecalcs += m_perf.netlistRecalcs - recalcs);
 }
 
 void ClassSimZ80_AVX2::handleMemRead(uint16_t ab)
 {
-    uint8_t db = ::controller.readMem(ab);
+    uint8_t db;
+    if (Q_UNLIKELY(ab < m_loader.size())) // Fast-forward loader overlay
+    {
+        db = m_loader.at(ab);
+        if (ab == m_loaderLast)
+            m_loader.clear();
+    }
+    else
+        db = ::controller.readMem(ab);
+    if (Q_UNLIKELY((ab >= TRICKBOX_START) && (ab <= TRICKBOX_END))) // The trickbox updates its area without writes
+        m_loopEvents++;
     setDB(db);
 }
 
@@ -890,6 +2997,7 @@ void ClassSimZ80_AVX2::handleMemWrite(uint16_t ab)
 {
     uint8_t db = readDB();
     ::controller.writeMem(ab, db);
+    m_loopEvents++;
 }
 
 void ClassSimZ80_AVX2::handleIORead(uint16_t ab)
@@ -902,6 +3010,7 @@ void ClassSimZ80_AVX2::handleIOWrite(uint16_t ab)
 {
     uint8_t db = readDB();
     ::controller.writeIO(ab, db);
+    m_loopEvents++;
 }
 
 void ClassSimZ80_AVX2::handleIrq()
@@ -955,7 +3064,7 @@ pin_t ClassSimZ80_AVX2::readBit(const QString &name)
     Q_ASSERT(n < MAX_NETS);
     if (m_netlist[n].floats)
         return getNetStateEx(n);
-    return m_netlist[n].state;
+    return testBit(m_netState, n);
 }
 
 pin_t ClassSimZ80_AVX2::readBit(net_t n)
@@ -963,17 +3072,17 @@ pin_t ClassSimZ80_AVX2::readBit(net_t n)
     Q_ASSERT(n < MAX_NETS);
     if (m_netlist[n].floats)
         return getNetStateEx(n);
-    return m_netlist[n].state;
+    return testBit(m_netState, n);
 }
 
 pin_t ClassSimZ80_AVX2::getNetStateEx(net_t n)
 {
-    tran_t* c1c2s = m_netlist[n].c1c2sTrans;
-    uint16_t count = m_netlist[n].c1c2sCount;
-
-    for (uint16_t i = 0; i < count; i++)
-        if (m_transOn[c1c2s[i]])
-            return !!m_netlist[n].state;
+    // The net is driven when any of its sources or drains is on: one AND per transistor word, with a single branch
+    uint64_t on = 0;
+    for (uint i = m_driverStart[n]; i < m_driverStart[n + 1]; i++)
+        on |= m_transOn[m_driverWords[i].word] & m_driverWords[i].mask;
+    if (on)
+        return testBit(m_netState, n);
 
     if (m_netlist[n].hasPullup)
         return 1;
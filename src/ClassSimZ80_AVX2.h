@@ -2,26 +2,225 @@
 #define CLASSSIMZ80_AVX2_H
 
 #include "AppTypes.h"
+#include "ClassSimZ80_Emu.h"
 #include "z80state.h"
 #include <QElapsedTimer>
 #include <QTimer>
 #include <QHash>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ClassSimZ80;
 
 // Cache line size for alignment
 #define CACHE_LINE_SIZE 64
 
+// Words of the bitsets: one bit per net ((MAX_NETS + 63) / 64 = 57, rounded up for AVX-512), one bit per transistor
+#define NET_WORDS   64
+#define TRANS_WORDS ((MAX_TRANS + 63) / 64)
+
+// Compiler portability: MSVC uses __forceinline and <intrin.h>; gcc and clang use attributes and <x86intrin.h>
+// SIM_TARGET marks a function compiled for a specific instruction set so that it can be selected at runtime
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIM_X86 1
+#else
+#define SIM_X86 0
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SIM_INLINE __forceinline
+#define SIM_TARGET(isa)
+#else
+#if SIM_X86
+#include <x86intrin.h>
+#endif
+#define SIM_INLINE inline __attribute__((always_inline))
+#define SIM_TARGET(isa) __attribute__((target(isa)))
+#endif
+#if SIM_X86
+#define SIM_PREFETCH(p) _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#elif defined(_MSC_VER)
+#define SIM_PREFETCH(p) __prefetch(p)
+#else
+#define SIM_PREFETCH(p) __builtin_prefetch(p)
+#endif
+
+// Index of the lowest set bit of a non-zero 64-bit value
+// Atomic load, OR and AND of a 64-bit word, for the state bitsets that the parallel workers read and update side by side
+#if defined(_MSC_VER)
+static SIM_INLINE uint simCtz64(uint64_t x) { unsigned long i; _BitScanForward64(&i, x); return i; }
+static SIM_INLINE uint64_t simAtomicLoad64(const uint64_t *p) { return uint64_t(__iso_volatile_load64(reinterpret_cast<const volatile __int64*>(p))); }
+static SIM_INLINE void simAtomicOr64(uint64_t *p, uint64_t x) { _InterlockedOr64(reinterpret_cast<volatile __int64*>(p), __int64(x)); }
+static SIM_INLINE void simAtomicAnd64(uint64_t *p, uint64_t x) { _InterlockedAnd64(reinterpret_cast<volatile __int64*>(p), __int64(x)); }
+#else
+static SIM_INLINE uint simCtz64(uint64_t x) { return __builtin_ctzll(x); }
+static SIM_INLINE uint64_t simAtomicLoad64(const uint64_t *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+static SIM_INLINE void simAtomicOr64(uint64_t *p, uint64_t x) { __atomic_fetch_or(p, x, __ATOMIC_RELAXED); }
+static SIM_INLINE void simAtomicAnd64(uint64_t *p, uint64_t x) { __atomic_fetch_and(p, x, __ATOMIC_RELAXED); }
+#endif
+
+// Instruction set level of the SIMD kernels, selected at runtime from the CPUID
+enum class SimIsa : unsigned char { Scalar, SSE2, AVX2, AVX512 };
+
+// Adjacency entry of a net: a transistor connected to it by source or drain, and the net on its other side
+struct NetEdge
+{
+    tran_t t;                   // Transistor index
+    net_t other;                // Net on the other side of the transistor (the net itself for a shorted transistor)
+};
+static_assert(sizeof(NetEdge) == 4, "The edge mask kernels load an edge as one 32-bit lane");
+
 // AVX2-optimized Net structure using raw arrays instead of QVector
+// The hot state of a net (its voltage and pulls) is kept in packed bitsets instead, see m_netState
 struct NetAVX2
 {
     tran_t* gatesTrans;         // Array of transistor indices (gates this net controls)
-    tran_t* c1c2sTrans;         // Array of transistor indices (transistors connected to this net)
+    NetEdge* c1c2s;             // Row of the CSR adjacency (transistors connected to this net)
     uint16_t gatesCount;        // Number of gates
     uint16_t c1c2sCount;        // Number of c1c2 connections
-    bool state;                 // Current voltage state
     bool floats;                // Can float (hi-Z)
-    bool isHigh;                // Being pulled high
-    bool isLow;                 // Being pulled low
     bool hasPullup;             // Has permanent pull-up resistor
+    bool cached;                // The component's groups are memoized in the group cache
+    uint16_t ccc;               // Channel-connected component id
+    uint16_t cccSize;           // Number of nets in that component
+    uint16_t gate;              // Static gate of the net (index + 1), or zero for the switch-level group resolution
+};
+
+// Static gate (see buildGates()): an output net whose transistors all lead to a power net, directly or in series
+// through gateless nets that nothing else connects to. It is a boolean node: the output is the value of the power net
+// that a conducting path reaches, else its pull-up, else it keeps its state; inverters, NOR, NAND and AND-OR-INVERT
+// gates and push/pull drivers are such structures. Pass transistors and buses keep the switch-level group resolution.
+#define GATE_MAX_SERIES 3                   // Longest series of transistors in a path (a 3-input NAND)
+struct GatePath
+{
+    tran_t t[GATE_MAX_SERIES];  // Transistors from the output net towards the power net
+    net_t v[GATE_MAX_SERIES];   // Net below each transistor; the last one is the power net
+    uint8_t len;                // Number of transistors
+};
+struct SimGate
+{
+    net_t out;                  // Output net
+    uint16_t pathStart;         // First path in m_gatePaths
+    uint16_t pathCount;
+};
+
+// Memoized group resolution: an entry maps the starting net, the on-state of its component's transistors and
+// the pulls of the component's nets to the resolved group (in search order) and the source of its value.
+// The nets are stored by their local index within the component, so that the isomorphic components (the replicated
+// bit slices of the register file, the ALU and the address incrementer) share their entries; see buildSlices().
+#define GROUP_CACHE_BITS     16             // Direct-mapped cache of 64K entries, one cache line each (4 MB)
+#define GROUP_CACHE_MAX_NETS 32             // Only the components up to 32 nets and 64 transistors are cached
+#define GROUP_MASKED_MIN_NETS 32            // Larger components are searched by rows of edges (addNetToGroupMasked())
+struct alignas(CACHE_LINE_SIZE) GroupCacheEntry
+{
+    uint64_t on;                // Key: on-state of the component's transistors, one bit per transistor
+    uint64_t pull;              // Key: isHigh and isLow of the component's nets, two bits per net
+    uint32_t key;               // Key: slice class and local index of the starting net (m_netCacheKey); zero if unused
+    uint8_t source;             // Local index + 1 of the net whose state gives the group value, or zero if constant
+    bool value;                 // Constant group value (power or pulled net)
+    bool reusable;              // The group resolves to the same value from any of its nets (isGroupReusable())
+    uint8_t count;              // Number of nets in the group
+    uint8_t group[GROUP_CACHE_MAX_NETS + 2]; // Local indices of the group nets; the component size is ngnd, +1 is npwr
+};
+
+// Parallel wavefront: a wave of at least PARALLEL_MIN_WAVE nets is split by channel-connected component across a pool
+// of worker threads. The result is the same as the serial evaluation for any number of threads.
+#define PARALLEL_MIN_WAVE    256            // Smaller waves are evaluated serially; the hand-off costs more than it gains
+#define PARALLEL_MIN_LEVEL   8              // Smaller levels of a wave are evaluated by the simulation thread alone
+#define PARALLEL_MAX_THREADS 16
+#define PARALLEL_SPIN        4096           // Polls of an idle worker for the next level before it sleeps
+struct WaveWorker;
+
+// Performance counters of the simulation, compiled in only with SIM_PERF_COUNTERS
+#if SIM_PERF_COUNTERS
+#define SIM_PERF(...) __VA_ARGS__
+#else
+#define SIM_PERF(...)
+#endif
+#define PERF_GROUP_BINS 10                  // Group size histogram bins: 1, 2, 3-4, 5-8, ... 129-256, and more
+struct SimPerfCounters
+{
+    quint64 netlistRecalcs {};          // recalcNetlist() calls
+    quint64 waves {};                   // Recalculation waves
+    quint64 maxWaves {};                // Most waves of a single recalcNetlist()
+    quint64 netRecalcs {};              // recalcNet() calls
+    quint64 waveDedups {};              // Nets of a wave skipped because an earlier net of the wave resolved their group
+    quint64 maxWaveDedups {};           // Most nets skipped in a single wave
+    quint64 groupVisits {};             // Adjacency entries that the group search visited (addNetToGroup())
+    quint64 groupSizes[PERF_GROUP_BINS] {}; // Histogram of the sizes of the evaluated groups
+    quint64 setDBRecalcs {};            // recalcNetlist() calls made by setDB()
+    quint64 halfCycles {};              // halfCycle() calls
+    quint64 halfCycleNs {};             // Time spent in halfCycle()
+    quint64 maxHalfCycleNs {};          // Longest halfCycle()
+    static SIM_INLINE uint groupBin(uint size)
+    {
+        uint bin = 0;
+        while ((bin < PERF_GROUP_BINS - 1) && (size > (1u << bin)))
+            bin++;
+        return bin;
+    }
+    SimPerfCounters &operator+=(const SimPerfCounters &c);
+    QString toString() const;
+};
+
+// Checkpoint of the simulation: the chip and the simulated environment at a half-cycle, for a fast rewind
+#define CHECKPOINT_INTERVAL 1000            // Initial number of half-cycles between the checkpoints (one per ~0.5s)
+#define CHECKPOINT_MAX      32              // When full, every other checkpoint is dropped and the interval doubles
+struct SimCheckpoint
+{
+    uint hcycle;                        // Half-cycle of the checkpoint
+    QVector<uint8_t> nets;              // Per net: bit 0 is the state, bit 1 pulled high, bit 2 pulled low
+    QVector<uint8_t> trans;             // Per transistor: on-state
+    QByteArray env;                     // Simulated RAM, IO and trickbox state (compressed)
+};
+
+// Steady-state loop skipping: a snapshot of the chip at the opcode fetch of a loop head (an address fetched after a
+// higher or the same one). When the chip returns to it with no memory or IO writes in between, the state repeats with
+// the period since the snapshot, and the simulation skips whole periods. The period of a loop is at least the cycle
+// of the refresh register R that the opcode fetches increment, so up to 128 iterations.
+#define LOOP_HEADS          16              // Number of loop heads followed at a time, by the address
+#define LOOP_MAX_VISITS     256             // Visits that do not repeat the snapshot before it is taken again
+#define LOOP_MAX_SKIP       100000          // Most half-cycles skipped at once; the run checks for stops in between
+struct SimLoopHead
+{
+    uint16_t pc;                        // Address of the opcode fetch
+    uint hcycle;                        // Half-cycle of the snapshot
+    uint events;                        // Number of writes and pin changes at the snapshot
+    uint visits;                        // Visits compared with the snapshot
+    QVector<uint64_t> nets;             // Bitsets of the net states, then pulled high, then pulled low
+};
+
+// Recorded simulation trace (see startRecording()): the chip state when the recording started and the input nets set
+// since then; each input starts a netlist recalculation, unless it is batched with the previous one (such as the data
+// bus bits), which it joins. Replaying the inputs from that state repeats the run exactly.
+struct SimTrace
+{
+    QVector<uint8_t> nets;              // Per net: bit 0 is the state, bit 1 pulled high, bit 2 pulled low
+    QVector<uint8_t> trans;             // Per transistor: on-state
+    struct Input { net_t n; bool on; bool batched; };
+    QVector<Input> inputs;              // Input nets set, in the order of the run
+    QVector<uint> hcycles;              // Index of the first input of every half-cycle
+    quint64 hash {};                    // Hash of the net states when the recording stopped
+    bool save(const QString &fileName) const;
+    bool load(const QString &fileName);
+};
+
+// Kernels that a trace replay times: whole recalculations, the evaluation of a net, its group search (getNetGroup()
+// and addNetToGroup()) and the group value (getNetValue()). The last two run on the groups of every wave, before it.
+enum class SimKernel : unsigned char { RecalcNetlist, RecalcNet, GroupSearch, NetValue };
+
+// Timing of one kernel replaying a trace
+struct SimKernelStats
+{
+    quint64 ns {};                      // Time spent in the kernel
+    quint64 calls {};                   // Number of kernel calls; nets for the per-net kernels
+    quint64 waves {};                   // Number of recalculation waves of the per-net kernels
+    quint64 sink {};                    // Combined kernel results, so the timed work is not optimized away
+    bool exact {};                      // The replay ended in the recorded state
 };
 
 /*
@@ -42,10 +241,50 @@ public:
     uint doReset();                         // Run chip reset sequence
     void doRunsim(uint ticks);              // Run the simulation for the given number of clocks
     bool setPin(uint index, pin_t p);       // Sets an input pin to a value
+    bool setPins(uint mask, uint values);   // Sets the input pins selected by the mask (bit index) together
     bool isRunning() { return m_runcount; }
     uint16_t getPC();
     uint getCurrentHCycle() { return m_hcycletotal; }
     uint getEstHz() { return m_estHz; }
+    quint64 getGroupCacheHits() { return m_groupCacheHits; }
+    quint64 getGroupCacheMisses() { return m_groupCacheMisses; }
+    quint64 getGroupReuses() { return m_groupReuses; } // Returns the net evaluations skipped because their group was valid
+    quint64 getWaveDedups() { return m_waveDedups; } // Returns the net evaluations skipped because their group was resolved in the same wave
+    uint getSliceClasses() { return m_sliceClasses; } // Returns the number of classes of replicated bit slices
+    uint getSliceComponents() { return m_sliceComponents; } // Returns the number of components in those classes
+    quint64 getNetsRecalculated() { return m_netsRecalculated; } // Returns the number of nets evaluated since the load
+    quint64 getHCyclesSkipped() { return m_hcyclesSkipped; } // Returns the half-cycles skipped in steady-state loops
+    void setLoopSkip(bool enable) { m_loopSkip = enable; } // Enables skipping the steady-state loops (by default)
+    const SimPerfCounters &getPerfCounters() { return m_perf; } // Returns the performance counters since the last reset
+    SimIsa getIsa() { return m_isa; }       // Returns the instruction set level of the selected kernels
+    static SimIsa detectIsa();              // Returns the best instruction set level supported by this CPU and OS
+    static const char *isaName(SimIsa isa);
+    uint getThreads() { return m_threads; } // Returns the number of threads evaluating the large waves
+    void setThreads(uint threads);          // Sets the number of threads evaluating the large waves; 1 is serial
+    bool setIsa(SimIsa isa);                // Selects the kernels of an instruction set level up to the detected one
+    bool rewind(uint hcycle);               // Rewinds to a half-cycle from the nearest checkpoint before it
+    uint getCheckpointCount() { return uint(m_checkpoints.size()); }
+    bool saveState(const QString &fileName); // Saves the complete simulation state into a file
+    bool loadState(const QString &fileName); // Loads the simulation state from a file, replacing a reset
+    bool fastForward(uint hcycles, int pc = -1); // Emulates the program from the reset, then continues on the netlist
+    bool lockstep(ClassSimZ80 &ref, uint hcycles, uint every = 1); // Runs in lockstep with the reference simulator
+
+    // Constant-net folding: the nets that never change after the reset, and the transistors that they keep off
+    void startTraining();                   // Starts observing which nets change, for saveConstants()
+    bool saveConstants(const QString &fileName); // Saves the constant nets, proven and observed since startTraining()
+    bool loadConstants(const QString &fileName, bool observed = false); // Leaves the transistors that constant nets keep off out of the netlist
+    net_t getFoldedChange() { return net_t(m_foldedChange.load()); } // Returns the folded net whose change stopped the simulation, or 0
+    uint getFoldedTrans() { return m_transFoldedCount; }
+    uint getGateCount() { return uint(m_gates.size()); } // Returns the number of static gates evaluated as boolean nodes
+    quint64 getGateEvals() { return m_gateEvals; } // Returns the number of boolean node evaluations since the reset
+
+    // Recording of the simulation inputs, and their replay timing the individual kernels (micro-benchmarks)
+    void startRecording();                  // Starts recording a trace from the current chip state
+    SimTrace stopRecording();               // Stops the recording and returns the trace
+    bool isRecording() { return m_trace; }
+    SimKernelStats replay(const SimTrace &trace, SimKernel kernel); // Replays a trace; leaves the chip in its final state
+    static const char *kernelName(SimKernel kernel);
+    quint64 getStateHash();                 // Returns a hash of the states of all nets
 
     // Net value reads exposed for scripting and instrumentation
     uint8_t readByte(const QString &name);
@@ -59,10 +298,17 @@ public:
 
     // Netlist query methods (compatible with ClassNetlist interface)
     uint getNetlistCount() { return MAX_NETS; }
-    bool getNetState(net_t i) { return m_netlist[i].state; }
+    bool getNetState(net_t i) { return testBit(m_netState, i); }
     bool isNetOrphan(net_t n) { return m_netlist[n].gatesCount == 0 && m_netlist[n].c1c2sCount == 0; }
     bool isNetPulledUp(net_t n) { return m_netlist[n].hasPullup; }
     bool isNetGateless(net_t n) { return m_netlist[n].gatesCount == 0; }
+    bool isNetFloating(net_t n) { return m_netlist[n].floats; }
+
+    // Read-only transistor topology, used by the engines that derive their netlist from this one
+    bool isTransOn(tran_t t) { return testBit(m_transOn, t); }
+    net_t getTransGate(tran_t t) { return m_transGate[t]; } // Zero for an unused transistor index
+    net_t getTransC1(tran_t t) { return m_transC1[t]; }     // Normalized so that c1 is never a power net
+    net_t getTransC2(tran_t t) { return m_transC2[t]; }
 
 public slots:
     void onShutdown();
@@ -70,7 +316,7 @@ public slots:
 private slots:
     void onTimeout();
 
-private:
+protected: // The simulator with the compiled netlist (ClassSimZ80_Compiled) derives from this class
     // Memory/IO handlers
     void handleMemRead(uint16_t ab);
     void handleMemWrite(uint16_t ab);
@@ -80,37 +326,174 @@ private:
 
     void setDB(uint8_t db);
     void set(bool on, const QString &name);
-    __forceinline void set(bool on, net_t n);  // Fast version using cached net_t
+    SIM_INLINE void set(bool on, net_t n) { set(&n, on, 1); } // Fast version using cached net_t
+    void set(const net_t *nets, uint values, uint count); // Sets the inputs together; bit i of the values is nets[i]
 
     //==================== AVX2 OPTIMIZED SIMULATOR ====================
 
     void halfCycle();
 
-    // AVX2 optimized bitset operations
-    __forceinline void clearBitset_AVX2(uint64_t* bitset);
-    __forceinline bool testBit(const uint64_t* bitset, net_t n);
-    __forceinline void setBit(uint64_t* bitset, net_t n);
-
-    // Core simulation functions
-    __forceinline void recalcNetlist();
-    __forceinline void recalcNet(net_t n);
-    __forceinline bool getNetValue();
-    __forceinline void getNetGroup(net_t n);
-    __forceinline void addNetToGroup(net_t n);
-    __forceinline void addRecalcNet(net_t n);
+    // Bitset operations; the clear kernel is selected at runtime (scalar, SSE2, AVX2 or AVX-512)
+    void selectKernels(SimIsa isa);
+    SimIsa m_isa {SimIsa::Scalar};
+    void (*m_clearBitset)(uint64_t* bitset) {};
+    SIM_INLINE void clearBitset(uint64_t* bitset) { m_clearBitset(bitset); }
+    // Mask of up to 64 edges of an adjacency row whose transistor is on and whose other net is not yet visited
+    uint64_t (*m_edgeMask)(const NetEdge* row, int count, const uint64_t* transOn, const uint64_t* visited) {};
+    static SIM_INLINE bool testBit(const uint64_t* bitset, uint16_t n) { return (bitset[n >> 6] >> (n & 63)) & 1; }
+    static SIM_INLINE bool testBitRelaxed(const uint64_t* bitset, uint16_t n) // The word may hold bits other workers write
+        { return (simAtomicLoad64(&bitset[n >> 6]) >> (n & 63)) & 1; }
+    static SIM_INLINE void setBit(uint64_t* bitset, uint16_t n) { bitset[n >> 6] |= 1ULL << (n & 63); }
+    static SIM_INLINE void clearBit(uint64_t* bitset, uint16_t n) { bitset[n >> 6] &= ~(1ULL << (n & 63)); }
+    static SIM_INLINE void flipBit(uint64_t* bitset, uint16_t n) { bitset[n >> 6] ^= 1ULL << (n & 63); }
+    static SIM_INLINE void writeBit(uint64_t* bitset, uint16_t n, bool value)
+        { bitset[n >> 6] = (bitset[n >> 6] & ~(1ULL << (n & 63))) | (uint64_t(value) << (n & 63)); }
+    static SIM_INLINE void writeBitAtomic(uint64_t* bitset, uint16_t n, bool value) // The word may hold other workers' bits
+        { value ? simAtomicOr64(&bitset[n >> 6], 1ULL << (n & 63)) : simAtomicAnd64(&bitset[n >> 6], ~(1ULL << (n & 63))); }
+    SIM_INLINE bool isPulled(net_t n) { return ((m_netHigh[n >> 6] | m_netLow[n >> 6]) >> (n & 63)) & 1; }
+
+    // Core simulation functions; the evaluation is shared with the simulator with the compiled netlist, which supplies
+    // its own topology: the group search of a net and its gate fan-out (see NetlistTopology)
+    struct NetlistTopology;
+    virtual void recalcNetlist();
+    template <class Topology> void recalcWaves();
+    template <class Topology> SIM_INLINE void runSerialWave();
+    template <class Topology, bool Tracked> SIM_INLINE void recalcNet(net_t n);
+    template <bool Tracked> SIM_INLINE void switchGate(tran_t t)
+    {
+        flipBit(m_transOn, t);
+        m_cccOn[m_transCcc[t]] ^= m_transCccBit[t];
+        if (Tracked)
+            m_cccGen[m_transCcc[t]]++;
+    }
+    template <bool Relaxed = false> SIM_INLINE bool getNetValue(const net_t* group, int count);
+    SIM_INLINE void getNetGroup(net_t n);
+    SIM_INLINE void addNetToGroup(net_t n);
+    SIM_INLINE void addNetToGroupMasked(net_t n);
+    SIM_INLINE bool getGateGroup(net_t n, bool &value);
+    SIM_INLINE void addRecalcNet(net_t n)
+    {
+        if (n <= npwr) return;
+
+        // O(1) duplicate check - inlined for zero call overhead
+        const uint64_t mask = 1ULL << (n & 63);
+        uint64_t& word = m_recalcBitset[n >> 6];
+        if (word & mask)
+            return;
+
+        word |= mask;
+        m_recalcList[m_recalcListIndex++] = n;
+    }
+    void storeGroup(GroupCacheEntry& e, net_t n, uint64_t on, uint64_t pull, const net_t* group, int count);
+    bool isGroupReusable(const net_t* group, int count);
+    void markGroupValid(net_t n, const net_t* group, int count);
+    SIM_INLINE void beginWave() // Marks the nets of a serial wave before it starts, for the deduplication
+    {
+        for (int i = 0; i < m_listIndex; i++)
+            setBit(m_waveNets, m_list[i]);
+        m_wavePowerGen = m_powerGen;
+    }
+    SIM_INLINE bool takeWaveNet(net_t n) // Returns true if the next net of the wave is resolved already
+    {
+        clearBit(m_waveNets, n);
+        if (!testBit(m_waveResolved, n))
+            return false;
+        clearBit(m_waveResolved, n);
+        return (m_netWaveGen[n] == m_cccGen[m_netlist[n].ccc]) && (m_wavePowerGen == m_powerGen);
+    }
+    SIM_INLINE void updatePull(net_t n);
+    SIM_INLINE void setPull(net_t n, bool on);
+
+    // Parallel wavefront evaluation
+    void recalcWaveParallel();
+    void buildConflicts();
+    void runWorker(WaveWorker &w);
+    void workerLoop(uint index, uint seen);
+    void startLevel();
+    void stopWorkers();
+    SIM_INLINE void recalcNetWorker(WaveWorker &w, uint pos);
+    SIM_INLINE void addNetToGroupWorker(WaveWorker &w, net_t n);
+    SIM_INLINE void addNetToGroupMaskedWorker(WaveWorker &w, net_t n);
+    void applyPowerChanges(uint start, uint count);
 
     // Bulk operations
     void allNets();
 
+    // Checkpoints
+    void saveNets(QVector<uint8_t> &nets, QVector<uint8_t> &trans);
+    void restoreNets(const uint8_t *nets, const uint8_t *trans);
+    void takeCheckpoint();
+    std::vector<SimCheckpoint> m_checkpoints; // Checkpoints since the reset, by half-cycle
+    uint m_checkpointInterval {CHECKPOINT_INTERVAL};
+    uint m_nextCheckpoint {UINT_MAX};   // Half-cycle of the next checkpoint; none until the chip is reset
+
+    // Fast-forward: the instruction-level emulator, and the loader program that hydrates the netlist with its state
+    bool isOpcodeFetch();
+    void readRegisters(z80state &z);
+    ClassSimZ80_Emu m_emu;
+    QByteArray m_loader;                // Loader program, read in place of the RAM at address 0 while it runs
+    int m_loaderLast {};                // Address of the last byte of the loader; reading it ends the loader
+
+    // Steady-state loop skipping
+    void skipLoop(uint16_t pc);
+    SimLoopHead m_loopHeads[LOOP_HEADS] {};
+    bool m_loopSkip {true};             // Environment variable Z80_SIM_LOOP_SKIP=0 disables it
+    uint m_loopEvents {};               // Memory and IO writes, trickbox reads, pin changes and state restores
+    uint16_t m_lastFetch {};            // Address of the last opcode fetch
+    quint64 m_hcyclesSkipped {};        // Half-cycles skipped since the reset
+
+    // Constant-net folding
+    QVector<int8_t> proveConstants();
+    QVector<bool> getInputNets();
+    bool m_training {};                 // Nets that change are being observed
+    uint8_t m_netChanged[MAX_NETS] {};  // The net's state changed since startTraining()
+    uint8_t m_transFolded[MAX_TRANS] {}; // Always off: left out of the adjacency and the components
+    uint8_t m_netFolded[MAX_NETS] {};   // Constant low net that gates folded transistors
+    std::atomic<uint> m_foldedChange {0}; // Folded net that changed its state after all; the simulation stops
+    SIM_INLINE void checkFoldedNet(net_t n)
+    {
+        if (Q_UNLIKELY(m_netFolded[n]))
+            m_foldedChange.store(n, std::memory_order_relaxed);
+    }
+    void stopFolded();
+    uint m_transFoldedCount {};
+
+    // Static gates evaluated as boolean nodes (mixed-level simulation)
+    void buildGates();
+    bool m_gatesEnabled {true};         // Environment variable Z80_SIM_GATES=0 disables them
+    std::vector<SimGate> m_gates;
+    std::vector<GatePath> m_gatePaths;
+    uint16_t m_netGatePath[MAX_NETS];   // Path of a net in series within a gate
+    uint8_t m_netGatePos[MAX_NETS];     // Position of that net in its path
+    quint64 m_gateEvals {};
+
+    // Trace recording and replay
+    void restoreTrace(const SimTrace &trace);
+    void replayNetlist(SimKernel kernel, SimKernelStats &stats);
+    SimTrace *m_trace {};                   // Trace being recorded, or null
+    std::vector<net_t> m_replayGroups;      // Groups of a wave, resolved before timing their values
+    std::vector<uint> m_replayGroupStart;
+
     // Private read helpers still used only inside the sim
     uint8_t readDB();   // Fast version using cached n_db[]
     uint16_t readAB();
     pin_t getNetStateEx(net_t n);
 
+    // Transistor bitset words of the sources and drains of each floating net, by m_driverStart (see buildDriverWords())
+    struct DriverWord { uint64_t mask; uint word; };
+    std::vector<DriverWord> m_driverWords;
+    uint m_driverStart[MAX_NETS + 1] {};
+
     //==================== DATA STRUCTURES ====================
 
+    // Packed state bitsets: the group search, the group value and the gate fan-out test and flip single bits, and a whole
+    // group or gate list touches a few words instead of a byte or a net structure per member
+    alignas(CACHE_LINE_SIZE) uint64_t m_transOn[TRANS_WORDS];   // ON state, one bit per transistor
+    alignas(CACHE_LINE_SIZE) uint64_t m_netState[NET_WORDS];    // Current voltage state, one bit per net
+    alignas(CACHE_LINE_SIZE) uint64_t m_netHigh[NET_WORDS];     // Being pulled high
+    alignas(CACHE_LINE_SIZE) uint64_t m_netLow[NET_WORDS];      // Being pulled low
+
     // Structure-of-Arrays for transistors (cache-line aligned)
-    alignas(CACHE_LINE_SIZE) uint8_t m_transOn[MAX_TRANS];      // ON state (0 or 1)
     alignas(CACHE_LINE_SIZE) net_t m_transC1[MAX_TRANS];        // c1 (source) net
     alignas(CACHE_LINE_SIZE) net_t m_transC2[MAX_TRANS];        // c2 (drain) net
     alignas(CACHE_LINE_SIZE) net_t m_transGate[MAX_TRANS];      // Gate net
@@ -120,22 +503,96 @@ private:
 
     // Memory pools for net connection arrays (single allocation)
     tran_t* m_gatesPool;        // Pool for all gates arrays
-    tran_t* m_c1c2sPool;        // Pool for all c1c2s arrays
+    NetEdge* m_adjPool;         // CSR adjacency: all c1c2s rows, each row a run of (transistor, other net) pairs
     size_t m_gatesPoolSize;
-    size_t m_c1c2sPoolSize;
+    size_t m_adjPoolSize;
 
     // Work lists (cache-line aligned)
     alignas(CACHE_LINE_SIZE) net_t m_list[MAX_NETS];
     alignas(CACHE_LINE_SIZE) net_t m_recalcList[MAX_NETS];
     alignas(CACHE_LINE_SIZE) net_t m_group[MAX_NETS];
+    friend struct WaveWorker;
+    struct GroupFrame { const NetEdge* next; const NetEdge* end; uint64_t mask; }; // The mask is of addNetToGroupMasked()
+    GroupFrame m_groupStack[MAX_NETS];  // Explicit stack of the depth-first group search
     int m_listIndex;
     int m_recalcListIndex;
     int m_groupIndex;
 
     // Bitsets for O(1) duplicate detection (512 bytes each, 8 cache lines)
     // Size: (MAX_NETS + 63) / 64 = 57 uint64_t, round up to 64 for AVX-512 alignment
-    alignas(CACHE_LINE_SIZE) uint64_t m_groupBitset[64];
-    alignas(CACHE_LINE_SIZE) uint64_t m_recalcBitset[64];
+    alignas(CACHE_LINE_SIZE) uint64_t m_groupBitset[NET_WORDS];
+    alignas(CACHE_LINE_SIZE) uint64_t m_recalcBitset[NET_WORDS];
+
+    // Channel-connected components (CCC): nets joined through the source/drain of any transistor, with
+    // the power nets excluded. A group can never extend beyond the component of the net it starts from,
+    // so only the group bitset words that hold the component's nets (and the power nets) need clearing.
+    uint64_t m_cccWordMask[MAX_NETS];   // Group bitset words used by each component, by component id
+    uint m_cccCount;                    // Number of components
+
+    // Group cache and the incrementally maintained keys of the cached components
+    GroupCacheEntry* m_groupCache;
+    uint64_t m_cccOn[MAX_NETS];         // On-state of the component's transistors, by component id
+    uint64_t m_cccPull[MAX_NETS];       // isHigh and isLow of the component's nets, by component id
+    uint64_t m_transCccBit[MAX_TRANS];  // Bit of the transistor in its component's on-state (0 if not cached)
+    uint16_t m_transCcc[MAX_TRANS];     // Component id of the transistor
+    uint8_t m_netPullShift[MAX_NETS];   // Position of the net's two pull bits within its component (local index * 2)
+    uint32_t m_netCacheKey[MAX_NETS];   // Slice class and local index of the net, the key of its cache entries
+    uint m_cccNetStart[MAX_NETS];       // First net of the component in m_cccNets, by component id
+    std::vector<net_t> m_cccNets;       // Nets of the cached components by local index, each followed by ngnd and npwr
+    uint m_sliceClasses {};             // Classes of isomorphic components with more than one member
+    uint m_sliceComponents {};          // Components in those classes
+    bool m_slicesEnabled {true};        // Environment variable Z80_SIM_SLICES=0 gives each component its own class
+
+    // Incremental groups: a resolved group stays valid until a transistor of its component switches or a pull in the
+    // component changes; until then, evaluating any of its nets again would find the same group with the same value.
+    // The power nets are shared by all components, and a group that shorts them overwrites their state, so a group
+    // with a power net is also valid only until a power net changes.
+    uint64_t m_cccGen[MAX_NETS];        // Generation of the component, advanced by every such change, by component id
+    uint64_t m_netGen[MAX_NETS];        // Generation of its component when the net's group was resolved, or ~0 if none
+    uint64_t m_netPowerGen[MAX_NETS];   // m_powerGen when the net's group was resolved if it holds a power net, else 0
+    uint64_t m_powerGen {1};            // Advanced by every change of the state of a power net
+    bool m_incremental {};              // Environment variable Z80_SIM_INCREMENTAL=1 enables the reuse of valid groups
+    bool m_tracked {};                  // The evaluation advances the generations: a mode that reuses groups is enabled
+    quint64 m_groupReuses {};           // Net evaluations skipped because their group was valid
+
+    // Per-wave group deduplication: when a net of the serial wave resolves a group, the other nets of the group that
+    // are in the same wave are marked resolved, and skipped when their turn comes, unless their component or a power
+    // net changed since (a net evaluated before them can switch a transistor of the component)
+    alignas(CACHE_LINE_SIZE) uint64_t m_waveNets[NET_WORDS];     // Nets of the current wave not evaluated yet
+    alignas(CACHE_LINE_SIZE) uint64_t m_waveResolved[NET_WORDS]; // Those of them that are marked resolved
+    uint64_t m_netWaveGen[MAX_NETS];    // Generation of its component when the net was marked resolved
+    uint64_t m_wavePowerGen {};         // m_powerGen at the start of the wave
+    bool m_waveDedup {};                // Environment variable Z80_SIM_WAVE_DEDUP=1 enables the deduplication
+    quint64 m_waveDedups {};            // Net evaluations skipped because their group was resolved in the same wave
+
+    quint64 m_groupCacheHits;
+    quint64 m_groupCacheMisses;
+    quint64 m_netsRecalculated {};      // Number of nets evaluated, counted by the recalculation waves
+    SimPerfCounters m_perf;             // Performance counters; they stay zero without SIM_PERF_COUNTERS
+
+    // Parallel wavefront: the wave is scheduled into levels of nets that can be evaluated in any order; the nets that
+    // each wave position queues for the next wave are merged in the wave order
+    uint m_threads {1};
+    std::vector<WaveWorker*> m_workers;
+    std::atomic<uint> m_waveGeneration {0};
+    std::atomic<uint> m_waveDone {0};
+    std::atomic<bool> m_workersQuit {false};
+    std::atomic<uint> m_workersParked {0};  // Workers sleeping on m_workersWake
+    std::mutex m_workersLock;
+    std::condition_variable m_workersWake;
+    std::vector<uint16_t> m_cccConflicts;   // Components that gate or are gated by a component, by m_cccConflictStart
+    uint m_cccConflictStart[MAX_NETS + 1];
+    uint16_t m_cccLevel[MAX_NETS];      // Last level of the component in the current wave, valid if its stamp matches
+    uint m_cccStamp[MAX_NETS];
+    uint m_waveStamp;
+    uint16_t m_posLevel[MAX_NETS];      // Level of each wave position
+    uint16_t m_levelPos[MAX_NETS];      // Wave positions sorted by level, each level keeping the wave order
+    uint m_levelStart[MAX_NETS + 1];
+    bool m_cccPowerGated[MAX_NETS];     // The component has transistors gated by a power net, by component id
+    // A power net in a group: its position in the queued nets, and the group value; the level applies it in the wave order
+    struct PowerChange { uint16_t at; uint8_t net; bool value; bool taken; };
+    struct WaveOutput { uint start; uint16_t count; uint8_t worker; uint8_t powers; PowerChange power[2]; };
+    WaveOutput m_waveOutput[MAX_NETS];  // Nets queued by each wave position, in its worker's buffer
 
     // Special net numbers (cached for performance - avoid QString lookups in hot path)
     net_t ngnd, npwr, nclk;
@@ -163,6 +620,204 @@ private:
     bool loadTransdefs(const QString dir);
     bool loadPullups(const QString dir);
     void convertToAVX2Layout();
+    bool markFloatingNets();
+    void buildDriverWords();
+    void buildComponents();
+    void buildSlices(const std::vector<bool> &cacheable);
 };
 
+//=============================================================================
+// NET EVALUATION - SHARED WITH THE SIMULATOR WITH THE COMPILED NETLIST
+//=============================================================================
+
+template <class Topology>
+void ClassSimZ80_AVX2::recalcWaves()
+{
+    SIM_PERF(quint64 waves = 0);
+    m_recalcListIndex = 0;
+    clearBitset(m_recalcBitset);
+
+    while (m_listIndex)
+    {
+        SIM_PERF(waves++);
+        m_netsRecalculated += m_listIndex;
+        if ((m_threads > 1) && (m_listIndex >= PARALLEL_MIN_WAVE))
+            recalcWaveParallel();
+        else
+            runSerialWave<Topology>();
+
+        memcpy(m_list, m_recalcList, m_recalcListIndex * sizeof(net_t));
+        m_listIndex = m_recalcListIndex;
+        m_recalcListIndex = 0;
+        clearBitset(m_recalcBitset);
+    }
+    SIM_PERF(m_perf.netlistRecalcs++);
+    SIM_PERF(m_perf.waves += waves);
+    SIM_PERF(m_perf.maxWaves = qMax(m_perf.maxWaves, waves));
+}
+
+/*
+ * Evaluates the nets of the wave in order, skipping those whose group an earlier net of the wave resolved (see
+ * recalcNet()). Without the modes that reuse groups, the evaluation does without their bookkeeping.
+ */
+template <class Topology>
+SIM_INLINE void ClassSimZ80_AVX2::runSerialWave()
+{
+    SIM_PERF(quint64 dedups = 0);
+    if (m_waveDedup)
+        beginWave();
+    for (int i = 0; i < m_listIndex; i++)
+    {
+        if (m_waveDedup && takeWaveNet(m_list[i]))
+        {
+            m_waveDedups++;
+            SIM_PERF(dedups++);
+            continue;
+        }
+        if (m_tracked)
+            recalcNet<Topology, true>(m_list[i]);
+        else
+            recalcNet<Topology, false>(m_list[i]);
+    }
+    SIM_PERF(m_perf.waveDedups += dedups);
+    SIM_PERF(m_perf.maxWaveDedups = qMax(m_perf.maxWaveDedups, dedups));
+}
+
+template <class Topology, bool Tracked>
+SIM_INLINE void ClassSimZ80_AVX2::recalcNet(net_t n)
+{
+    SIM_PERF(m_perf.netRecalcs++);
+    if (n <= npwr) return;
+
+    // The net's group was resolved since the last change in its component: its nets already hold the group value
+    const uint16_t netCcc = m_netlist[n].ccc;
+    if (Tracked && (m_netGen[n] == m_cccGen[netCcc]) && (!m_netPowerGen[n] || (m_netPowerGen[n] == m_powerGen)))
+    {
+        m_groupReuses++;
+        return;
+    }
+
+    const net_t* group = m_group;
+    bool newState;
+    bool reusable = false;
+    if (m_netlist[n].gate && Topology::getGateGroup(*this, n, newState))
+        m_gateEvals++;
+    else if (m_netlist[n].cached)
+    {
+        // The group and its value source depend only on the component's transistors and pulls
+        const uint16_t ccc = m_netlist[n].ccc;
+        const uint64_t on = m_cccOn[ccc];
+        const uint64_t pull = m_cccPull[ccc];
+        const uint32_t key = m_netCacheKey[n];
+        const uint64_t hash = (on ^ (pull * 0x9E3779B97F4A7C15ULL) ^ (uint64_t(key) << 40)) * 0xD6E8FEB86659FD93ULL;
+        GroupCacheEntry& e = m_groupCache[hash >> (64 - GROUP_CACHE_BITS)];
+        if ((e.key == key) && (e.on == on) && (e.pull == pull))
+        {
+            m_groupCacheHits++;
+            const net_t* nets = &m_cccNets[m_cccNetStart[ccc]]; // The entry may come from an isomorphic component
+            for (uint i = 0; i < e.count; i++)
+                m_group[i] = nets[e.group[i]];
+            m_groupIndex = e.count;
+            newState = e.source ? testBit(m_netState, nets[e.source - 1]) : e.value;
+            reusable = e.reusable;
+        }
+        else
+        {
+            m_groupCacheMisses++;
+            Topology::getNetGroup(*this, n);
+            newState = getNetValue(m_group, m_groupIndex);
+            storeGroup(e, n, on, pull, m_group, m_groupIndex);
+            reusable = e.reusable;
+        }
+    }
+    else
+    {
+        Topology::getNetGroup(*this, n);
+        newState = getNetValue(m_group, m_groupIndex);
+        reusable = Tracked && isGroupReusable(m_group, m_groupIndex);
+    }
+
+    SIM_PERF(m_perf.groupSizes[SimPerfCounters::groupBin(m_groupIndex)]++);
+    if (Tracked && reusable && m_incremental)
+        markGroupValid(n, group, m_groupIndex);
+    // The nets of the group due later in the wave resolve the same group
+    const bool waveMark = Tracked && reusable && m_waveDedup;
+    const uint64_t gen = Tracked ? m_cccGen[netCcc] : 0;
+
+    // Process all nets in the group; a transistor that switches in the component invalidates the group right away
+    const net_t* groupEnd = group + m_groupIndex;
+    for (const net_t* p = group; p < groupEnd; p++)
+    {
+        if (waveMark && testBit(m_waveNets, *p))
+        {
+            setBit(m_waveResolved, *p);
+            m_netWaveGen[*p] = gen;
+        }
+        if (testBit(m_netState, *p) == newState) continue;
+        if (Tracked && (*p <= npwr))
+            m_powerGen++;
+        writeBit(m_netState, *p, newState);
+        if (m_training)
+            m_netChanged[*p] = 1; // Observed by the constant-net folding
+        checkFoldedNet(*p);
+
+        // A transistor is on exactly when its gate net is high, so every gate of a net that changed flips, without
+        // testing its current state
+        if (newState)
+        {
+            // Net went HIGH - turn on transistors
+            Topology::forGates(*this, *p, [this](tran_t t, net_t c1, net_t)
+            {
+                switchGate<Tracked>(t);
+                addRecalcNet(c1);
+            });
+        }
+        else
+        {
+            // Net went LOW - turn off transistors
+            Topology::forGates(*this, *p, [this](tran_t t, net_t c1, net_t c2)
+            {
+                switchGate<Tracked>(t);
+                addRecalcNet(c1);
+                addRecalcNet(c2);
+            });
+        }
+    }
+}
+
+template <bool Relaxed>
+SIM_INLINE bool ClassSimZ80_AVX2::getNetValue(const net_t* group, int count)
+{
+    // Fast path: check first element for power connections
+    if (group[0] <= npwr)
+        return group[0] == npwr;
+
+    // Single pass without an exit: accumulate the pulls of the nets from the packed bitsets, and track the strongest
+    // floating net by gate-connection count, which the compiler can lower to CMOV. Pulled nets are rare; only then
+    // a second pass finds the first of them in the group order, which has the highest priority.
+    const net_t* groupEnd = group + count;
+    uint64_t pulled = 0;
+    bool max_state = false;
+    uint16_t max_conn = 0;
+
+    for (const net_t* p = group; p < groupEnd; p++)
+    {
+        const net_t n = *p;
+        pulled |= (m_netHigh[n >> 6] | m_netLow[n >> 6]) >> (n & 63);
+        const uint16_t conn = m_netlist[n].gatesCount;
+        const bool stronger = conn > max_conn;
+        max_state = stronger ? (Relaxed ? testBitRelaxed(m_netState, n) : testBit(m_netState, n)) : max_state;
+        max_conn = stronger ? conn : max_conn;
+    }
+    if (Q_UNLIKELY(pulled & 1))
+    {
+        for (const net_t* p = group; p < groupEnd; p++)
+        {
+            if (isPulled(*p))
+                return testBit(m_netHigh, *p);
+        }
+    }
+    return max_state;
+}
+
 #endif // CLASSSIMZ80_AVX2_H
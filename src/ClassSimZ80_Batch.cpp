@@ -0,0 +1,773 @@
+#include "ClassController.h"
+#include "ClassSimZ80_Batch.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QStringBuilder>
+#include <QtConcurrent>
+
+const static QStringList pins = { "int", "nmi", "busrq", "wait", "reset" };
+
+ClassSimZ80_Batch::ClassSimZ80_Batch()
+{
+    memset(m_groupIdx, -1, sizeof(m_groupIdx));
+}
+
+ClassSimZ80_Batch::~ClassSimZ80_Batch()
+{
+    delete[] m_lane;
+}
+
+/*
+ * Copies the netlist topology from the optimized simulator, which must already be loaded and initialized
+ */
+bool ClassSimZ80_Batch::loadNetlist(ClassSimZ80_AVX2 &sim)
+{
+    m_netlist.resize(MAX_NETS);
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        if (!sim.get(n).isEmpty())
+            m_netnums[sim.get(n)] = n;
+        m_netlist[n].floats = sim.isNetFloating(n);
+        m_netlist[n].hasPullup = sim.isNetPulledUp(n);
+    }
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+    {
+        net_t gate = sim.getTransGate(t);
+        if (!gate)
+            continue;
+        m_transC1[t] = sim.getTransC1(t);
+        m_transC2[t] = sim.getTransC2(t);
+        m_netlist[gate].gates.append(t);
+        m_netlist[m_transC1[t]].c1c2s.append(t);
+        m_netlist[m_transC2[t]].c1c2s.append(t);
+    }
+    for (net_t n = 0; n < MAX_NETS; n++)
+        m_gatesCount[n] = m_netlist[n].gates.count();
+
+    auto get = [this](const QString &name) { return m_netnums.value(name, 0); };
+    n_rfsh = get("_rfsh");
+    n_m1   = get("_m1");
+    n_mreq = get("_mreq");
+    n_rd   = get("_rd");
+    n_wr   = get("_wr");
+    n_iorq = get("_iorq");
+    n_t2   = get("t2");
+    n_t3   = get("t3");
+    for (int i = 0; i < 8; i++)
+    {
+        n_db[i] = get(QString("db%1").arg(i));
+        n_pc[i] = get(QString("reg_pcl%1").arg(i));
+        n_pc[i + 8] = get(QString("reg_pch%1").arg(i));
+    }
+    for (int i = 0; i < 16; i++)
+        n_ab[i] = get(QString("ab%1").arg(i));
+    for (int i = 0; i < MAX_PIN_CTRL; i++)
+        n_pins[i] = get("_" % pins[i]);
+
+    m_list.reserve(MAX_NETS);
+    m_recalcList.reserve(MAX_NETS);
+    m_listLanes.reserve(MAX_NETS);
+    m_recalcListLanes.reserve(MAX_NETS);
+    qInfo() << "Batch simulator supports up to" << MAX_LANES << "lanes";
+    return n_rfsh && n_ab[15] && n_db[7] && n_pc[15] && n_pins[MAX_PIN_CTRL - 1];
+}
+
+/*
+ * Resets all lanes: each lane gets a copy of the current simulated RAM and IO space and a cleared trickbox control
+ * Lanes are then individually set up (ex. setAt) before calling run()
+ */
+bool ClassSimZ80_Batch::init(uint lanes)
+{
+    if (m_runcount || (lanes == 0) || (lanes > MAX_LANES) || m_netlist.isEmpty())
+    {
+        qWarning() << "Batch: unable to init" << lanes << "lanes (permitted 1 to" << MAX_LANES << "and not while running)";
+        return false;
+    }
+    if (!m_lane)
+        m_lane = new BatchLane[MAX_LANES];
+
+    m_lanes = lanes;
+    m_rom = ::controller.getTrickbox().getRom();
+    for (uint i = 0; i < MAX_LANES; i++)
+    {
+        BatchLane &l = m_lane[i];
+        memcpy(l.mem, ::controller.getTrickbox().getMem(), sizeof(l.mem));
+        memcpy(l.mio, ::controller.getTrickbox().getIO(), sizeof(l.mio));
+        l.tb = (trick *)&l.mem[TRICKBOX_START];
+        memset(l.tb, 0, sizeof(trick));
+        for (uint j = 0; j < MAX_PIN_CTRL; j++)
+            l.tb->pinCtrl[j].hold = TRICKBOX_PIN_HOLD;
+        l.trickWriteEven = true;
+        l.stopped = i >= lanes; // Unused lanes never see a clock edge
+        l.hcycle = 0;
+        l.console.clear();
+    }
+    doReset();
+    qInfo() << "Batch: initialized" << lanes << "lanes";
+    return true;
+}
+
+/*
+ * Runs the chip reset sequence in all lanes at once
+ */
+void ClassSimZ80_Batch::doReset()
+{
+    for (auto &net : m_netlist)
+    {
+        net.state = 0;
+        net.isHigh = net.hasPullup ? ~0ULL : 0;
+        net.isLow = 0;
+    }
+    m_netlist[npwr].state = ~0ULL;
+    memset(m_transOn, 0, sizeof(m_transOn));
+
+    set(n_pins[4], 0, ~0ULL); // _reset
+    set(nclk, ~0ULL, ~0ULL);
+    for (uint i = 0; i < 4; i++) // _int, _nmi, _busrq, _wait
+        set(n_pins[i], ~0ULL, ~0ULL);
+    allNets();
+    recalcNetlist();
+
+    for (int i = 0; i < 8; i++)
+        halfCycle();
+
+    set(n_pins[4], ~0ULL, ~0ULL);
+}
+
+void ClassSimZ80_Batch::run(uint hcycles)
+{
+    if (m_runcount || !m_lanes)
+        return;
+    m_runcount = hcycles ? hcycles : INT_MAX;
+    QFuture<void> future = QtConcurrent::run([=]() { runBlocking(hcycles); });
+}
+
+/*
+ * Runs all lanes until every lane has stopped, the batch is stopped or hcycles (0 for unlimited) have passed
+ */
+void ClassSimZ80_Batch::runBlocking(uint hcycles)
+{
+    m_runcount = hcycles ? hcycles : INT_MAX;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    uint count = 0;
+    while (m_runcount.fetchAndAddOrdered(-1) > 0)
+    {
+        halfCycle();
+        count++;
+        bool any = false;
+        for (uint i = 0; (i < m_lanes) && !any; i++)
+            any = !m_lane[i].stopped;
+        if (!any)
+            break;
+    }
+    m_runcount = 0;
+    m_estHz = (count / 2.0) / qMax(elapsed.elapsed() / 1000.0, 0.001);
+    qInfo() << "Batch: ran" << count << "half-cycles of" << m_lanes << "lanes at" << m_estHz << "Hz per lane";
+}
+
+/*
+ * Advance all running lanes by one half-cycle of the clock
+ */
+void ClassSimZ80_Batch::halfCycle()
+{
+    uint64_t running = 0;
+    for (uint i = 0; i < MAX_LANES; i++)
+        running |= uint64_t(!m_lane[i].stopped) << i;
+
+    const uint64_t clk = m_netlist[nclk].state;
+    const uint64_t service = ~clk & readMask(n_rfsh) & running; // Lanes servicing the chip pins
+    if (service)
+    {
+        const uint64_t m1   = readMask(n_m1);
+        const uint64_t mreq = readMask(n_mreq);
+        const uint64_t rd   = readMask(n_rd);
+        const uint64_t wr   = readMask(n_wr);
+        const uint64_t iorq = readMask(n_iorq);
+        const uint64_t t2   = readMask(n_t2);
+        const uint64_t t3   = readMask(n_t3);
+
+        const uint64_t memRd = service & ((~m1 & ~mreq & ~rd & wr & iorq & t2) | (m1 & ~mreq & ~rd & wr & iorq & t3));
+        const uint64_t memWr = service & m1 & ~mreq & rd & ~wr & iorq & t3;
+        const uint64_t ioRd  = service & m1 & mreq & ~rd & wr & ~iorq & t3;
+        const uint64_t ioWr  = service & m1 & mreq & rd & ~wr & ~iorq & t3;
+        const uint64_t irq   = service & ~m1 & mreq & rd & wr & ~iorq;
+
+        for (uint i = 0; (i < MAX_LANES) && ((memWr | ioWr) >> i); i++)
+        {
+            const uint64_t bit = 1ULL << i;
+            if (!((memWr | ioWr) & bit))
+                continue;
+            const uint16_t ab = readValue(n_ab, 16, i);
+            const uint8_t db = readValue(n_db, 8, i);
+            if (memWr & bit)
+                laneWriteMem(i, ab, db);
+            else
+                laneWriteIO(i, ab, db);
+        }
+
+        const uint64_t reads = memRd | ioRd | irq;
+        if (reads)
+        {
+            uint64_t db[8] {};
+            for (uint i = 0; (i < MAX_LANES) && (reads >> i); i++)
+            {
+                const uint64_t bit = 1ULL << i;
+                if (!(reads & bit))
+                    continue;
+                BatchLane &l = m_lane[i];
+                uint16_t ab = readValue(n_ab, 16, i);
+                uint8_t value;
+                if (memRd & bit)
+                    value = l.mem[ab];
+                else if (ioRd & bit)
+                    value = l.mio[((ab & 0xFE) == 0x80) ? (ab & 0xFF) : ab];
+                else
+                    value = l.mio[0x81]; // IO address 0x81 holds the value to be shown on the bus during interrupt
+                for (uint j = 0; j < 8; j++)
+                    db[j] |= uint64_t((value >> j) & 1) << i;
+            }
+            const uint64_t lanes[8] = { reads, reads, reads, reads, reads, reads, reads, reads };
+            set(n_db, db, lanes, 8); // All eight bits settle together
+        }
+    }
+
+    set(nclk, ~clk, running); // Let the clock edge propagate through the chip
+
+    uint64_t assert[MAX_PIN_CTRL] {}, release[MAX_PIN_CTRL] {};
+    for (uint i = 0; (i < MAX_LANES) && (running >> i); i++)
+    {
+        if (!((running >> i) & 1))
+            continue;
+        laneTick(i, assert, release);
+        m_lane[i].hcycle++;
+    }
+    uint64_t lanes[MAX_PIN_CTRL]; // The pins that change on this tick settle together; a lane asserts or releases a pin
+    for (uint i = 0; i < MAX_PIN_CTRL; i++)
+        lanes[i] = assert[i] | release[i];
+    set(n_pins, release, lanes, MAX_PIN_CTRL);
+}
+
+/*
+ * Pulls the nets high (or low) in their selected lanes and settles the netlist once, for all of them
+ * As in the scalar simulators, a net is recalculated only in the lanes in which its pull changed
+ * The nets must be distinct
+ */
+void ClassSimZ80_Batch::set(const net_t *nets, const uint64_t *high, const uint64_t *lanes, uint count)
+{
+    m_list.clear();
+    m_listLanes.clear();
+    for (uint i = 0; i < count; i++)
+    {
+        NetBatch &net = m_netlist[nets[i]];
+        const uint64_t changed = (net.isHigh ^ high[i]) & lanes[i];
+        if (!changed)
+            continue;
+        net.isHigh ^= changed;
+        net.isLow = (net.isLow & ~changed) | (~net.isHigh & changed);
+        m_list.append(nets[i]);
+        m_listLanes.append(changed);
+    }
+    recalcNetlist();
+}
+
+void ClassSimZ80_Batch::recalcNetlist()
+{
+    while (!m_list.isEmpty())
+    {
+        m_recalcList.clear();
+        m_recalcListLanes.clear();
+        for (int i = 0; i < m_list.count(); i++)
+            recalcNet(m_list[i], m_listLanes[i]);
+        for (net_t n : m_recalcList)
+            m_recalcLanes[n] = 0;
+        std::swap(m_list, m_recalcList);
+        std::swap(m_listLanes, m_recalcListLanes);
+    }
+}
+
+/*
+ * Resolves the group of nets connected to net n, in the given lanes at once; the other lanes are left alone
+ *
+ * The group is collected as a union over these lanes: it follows every transistor that is on in any of them.
+ * Each member then gets a mask of lanes in which it is actually connected to n, by propagating the
+ * reachability through the transistor on-masks until it settles. The value is resolved per lane with the
+ * same rules as the scalar simulators: power nets first, then the first pulled net, then the floating net
+ * with the most gate connections. The lanes in which the order of the group decides the value (both power
+ * nets, or pulled or floating nets that disagree) resolve it by their own group search, see getLaneValue().
+ */
+void ClassSimZ80_Batch::recalcNet(net_t n, uint64_t lanes)
+{
+    if (n <= npwr)
+        return;
+    m_group.clear();
+    m_edges.clear();
+    addNetToGroup(n, lanes);
+
+    const int count = m_group.count();
+    m_reach.fill(0, count);
+    m_reach[0] = lanes;
+    bool uniform = true; // All the lanes see the same connections (lanes did not diverge here)
+    for (const Edge &e : m_edges)
+        uniform &= ((m_transOn[e.t] & lanes) == lanes);
+    if (uniform)
+        m_reach.fill(lanes);
+    else
+    {
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (const Edge &e : m_edges)
+            {
+                const uint64_t on = m_transOn[e.t];
+                const uint64_t a = m_reach[e.a], b = m_reach[e.b];
+                const uint64_t b2 = b | (a & on);
+                const uint64_t a2 = (m_group[e.b] <= npwr) ? a : (a | (b & on)); // Power nets do not connect through
+                if ((a2 != a) || (b2 != b))
+                {
+                    m_reach[e.a] = a2;
+                    m_reach[e.b] = b2;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Resolve the group value in each lane; "ordered" holds the lanes in which the order of the group decides it
+    const uint64_t gnd = (m_groupIdx[ngnd] >= 0) ? m_reach[m_groupIdx[ngnd]] : 0;
+    const uint64_t pwr = (m_groupIdx[npwr] >= 0) ? m_reach[m_groupIdx[npwr]] : 0;
+    uint64_t decided = gnd | pwr, value = pwr & ~gnd, ordered = gnd & pwr;
+    uint64_t hi = 0, lo = 0;
+    m_byGates.clear();
+    for (int i = 0; i < count; i++)
+    {
+        const net_t m = m_group[i];
+        if (m <= npwr)
+            continue;
+        const NetBatch &net = m_netlist[m];
+        hi |= m_reach[i] & net.isHigh;
+        lo |= m_reach[i] & net.isLow & ~net.isHigh;
+        if (m_gatesCount[m])
+            m_byGates.append(i);
+    }
+    hi &= ~decided;
+    lo &= ~decided;
+    value |= hi & ~lo;
+    ordered |= hi & lo;
+    decided |= hi | lo;
+    if (lanes & ~decided)
+    {
+        // Floating lanes take the state of the members with the most gates, level by level
+        std::stable_sort(m_byGates.begin(), m_byGates.end(),
+            [this](uint16_t a, uint16_t b) { return m_gatesCount[m_group[a]] > m_gatesCount[m_group[b]]; });
+        for (int i = 0; (i < m_byGates.count()) && (lanes & ~decided); )
+        {
+            const uint16_t gates = m_gatesCount[m_group[m_byGates[i]]];
+            hi = lo = 0;
+            for (; (i < m_byGates.count()) && (m_gatesCount[m_group[m_byGates[i]]] == gates); i++)
+            {
+                const uint64_t sel = m_reach[m_byGates[i]] & ~decided;
+                hi |= sel & m_netlist[m_group[m_byGates[i]]].state;
+                lo |= sel & ~m_netlist[m_group[m_byGates[i]]].state;
+            }
+            value |= hi & ~lo;
+            ordered |= hi & lo;
+            decided |= hi | lo;
+        }
+    }
+    for (uint i = 0; (i < MAX_LANES) && (ordered >> i); i++)
+    {
+        if ((ordered >> i) & 1)
+            value = (value & ~(1ULL << i)) | (uint64_t(getLaneValue(n, i)) << i);
+    }
+
+    // Apply the new value to the group members and propagate to the transistors they control, in the lanes
+    // in which the transistors changed
+    for (int i = 0; i < count; i++)
+    {
+        const net_t m = m_group[i];
+        m_groupIdx[m] = -1;
+        if (m <= npwr)
+            continue;
+        NetBatch &net = m_netlist[m];
+        const uint64_t changed = (net.state ^ value) & m_reach[i];
+        if (!changed)
+            continue;
+        net.state ^= changed;
+        for (tran_t t : net.gates)
+        {
+            const uint64_t on = m_transOn[t];
+            const uint64_t on2 = (on & ~changed) | (value & changed);
+            if (on == on2)
+                continue;
+            m_transOn[t] = on2;
+            addRecalcNet(m_transC1[t], on ^ on2);
+            if (on & ~on2)
+                addRecalcNet(m_transC2[t], on & ~on2);
+        }
+    }
+}
+
+void ClassSimZ80_Batch::addNetToGroup(net_t n, uint64_t lanes)
+{
+    if (m_groupIdx[n] >= 0)
+        return;
+    m_groupIdx[n] = m_group.count();
+    m_group.append(n);
+    if (n <= npwr)
+        return;
+
+    for (tran_t t : m_netlist[n].c1c2s)
+    {
+        if (!(m_transOn[t] & lanes))
+            continue;
+        const net_t other = (m_transC1[t] == n) ? m_transC2[t] : m_transC1[t];
+        if (other == n)
+            continue;
+        addNetToGroup(other, lanes);
+        // Record each connection once: from its lower net, or from the net side for the power connections
+        if ((other <= npwr) || (n < other))
+            m_edges.append({ uint16_t(m_groupIdx[n]), uint16_t(m_groupIdx[other]), t });
+    }
+}
+
+void ClassSimZ80_Batch::addRecalcNet(net_t n, uint64_t lanes)
+{
+    lanes &= ~m_recalcLanes[n]; // The lanes that already have the net queued keep its place
+    if ((n <= npwr) || !lanes)
+        return;
+    m_recalcLanes[n] |= lanes;
+    if (!m_recalcList.isEmpty() && (m_recalcList.last() == n))
+        m_recalcListLanes.last() |= lanes;
+    else
+    {
+        m_recalcList.append(n);
+        m_recalcListLanes.append(lanes);
+    }
+}
+
+/*
+ * Resolves the value of the group of net n in a single lane, with the group search and the rules of the scalar
+ * simulators: a power net found by the search is kept at position 0 (so of the two shorted power nets, the last
+ * one found wins), then the first pulled net in the search order, then the first net with the most gates
+ */
+bool ClassSimZ80_Batch::getLaneValue(net_t n, uint lane)
+{
+    m_laneGroup.clear();
+    addNetToLaneGroup(n, lane);
+    for (net_t m : m_laneGroup)
+        m_laneBitset[m >> 6] &= ~(1ULL << (m & 63));
+
+    if (m_laneGroup[0] <= npwr)
+        return m_laneGroup[0] == npwr;
+    for (net_t m : m_laneGroup)
+    {
+        if ((m_netlist[m].isHigh | m_netlist[m].isLow) & (1ULL << lane))
+            return (m_netlist[m].isHigh >> lane) & 1;
+    }
+    bool value = false;
+    uint16_t gates = 0;
+    for (net_t m : m_laneGroup)
+    {
+        if (m_gatesCount[m] > gates)
+        {
+            gates = m_gatesCount[m];
+            value = (m_netlist[m].state >> lane) & 1;
+        }
+    }
+    return value;
+}
+
+void ClassSimZ80_Batch::addNetToLaneGroup(net_t n, uint lane)
+{
+    uint64_t &word = m_laneBitset[n >> 6];
+    if (word & (1ULL << (n & 63)))
+        return;
+    word |= 1ULL << (n & 63);
+    m_laneGroup.append(n);
+    if (n <= npwr)
+    {
+        std::swap(m_laneGroup[0], m_laneGroup.last());
+        return;
+    }
+
+    for (tran_t t : m_netlist[n].c1c2s)
+    {
+        if (!((m_transOn[t] >> lane) & 1))
+            continue;
+        const net_t other = (m_transC1[t] == n) ? m_transC2[t] : m_transC1[t];
+        if (other != n)
+            addNetToLaneGroup(other, lane);
+    }
+}
+
+void ClassSimZ80_Batch::allNets()
+{
+    m_list.clear();
+    m_listLanes.clear();
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        if ((n == ngnd) || (n == npwr) || (m_netlist[n].gates.isEmpty() && m_netlist[n].c1c2s.isEmpty()))
+            continue;
+        m_list.append(n);
+        m_listLanes.append(~0ULL);
+    }
+}
+
+//=============================================================================
+// READ OPERATIONS
+//=============================================================================
+
+uint64_t ClassSimZ80_Batch::readMask(net_t n)
+{
+    const NetBatch &net = m_netlist[n];
+    if (!net.floats)
+        return net.state;
+    uint64_t driven = 0;
+    for (tran_t t : net.c1c2s)
+        driven |= m_transOn[t];
+    return (net.state & driven) | ~driven;
+}
+
+pin_t ClassSimZ80_Batch::readBit(net_t n, uint lane)
+{
+    const NetBatch &net = m_netlist[n];
+    if (net.floats)
+    {
+        uint64_t driven = 0;
+        for (tran_t t : net.c1c2s)
+            driven |= m_transOn[t];
+        if (!((driven >> lane) & 1))
+            return net.hasPullup ? 1 : 2;
+    }
+    return (net.state >> lane) & 1;
+}
+
+uint ClassSimZ80_Batch::readValue(const net_t *nets, uint count, uint lane)
+{
+    uint value = 0;
+    for (int i = count - 1; i >= 0; --i)
+        value = (value << 1) | !!readBit(nets[i], lane);
+    return value;
+}
+
+uint8_t ClassSimZ80_Batch::readByte(const QString &name, uint lane)
+{
+    net_t nets[8];
+    for (int i = 0; i < 8; i++)
+        nets[i] = m_netnums.value(name % QString::number(i), 0);
+    return readValue(nets, 8, lane);
+}
+
+void ClassSimZ80_Batch::readState(z80state &z, uint lane)
+{
+    auto bit = [this, lane](const char *name) { return readBit(m_netnums.value(name, 0), lane); };
+    auto word = [this, lane](const char *hi, const char *lo) { return uint16_t((readByte(hi, lane) << 8) | readByte(lo, lane)); };
+
+    z.ab = readValue(n_ab, 16, lane);
+    z.db = readValue(n_db, 8, lane);
+
+    z.ab0 = bit("ab0");
+    z.db0 = bit("db0");
+    z.mreq = bit("_mreq");
+    z.iorq = bit("_iorq");
+    z.rd = bit("_rd");
+    z.wr = bit("_wr");
+
+    z.busak = bit("_busak");
+    z.busrq = bit("_busrq");
+    z.clk = bit("clk");
+    z.halt = bit("_halt");
+    z.intr = bit("_int");
+    z.m1 = bit("_m1");
+    z.nmi = bit("_nmi");
+    z.reset = bit("_reset");
+    z.rfsh = bit("_rfsh");
+    z.wait = bit("_wait");
+
+    z.af = word("reg_a", "reg_f");
+    z.bc = word("reg_b", "reg_c");
+    z.de = word("reg_d", "reg_e");
+    z.hl = word("reg_h", "reg_l");
+    z.af2 = word("reg_aa", "reg_ff");
+    z.bc2 = word("reg_bb", "reg_cc");
+    z.de2 = word("reg_dd", "reg_ee");
+    z.hl2 = word("reg_hh", "reg_ll");
+    z.ix = word("reg_ixh", "reg_ixl");
+    z.iy = word("reg_iyh", "reg_iyl");
+    z.sp = word("reg_sph", "reg_spl");
+    z.ir = word("reg_i", "reg_r");
+    z.wz = word("reg_w", "reg_z");
+    z.pc = readValue(n_pc, 16, lane);
+
+    z.instr = readByte("instr", lane);
+    z.nED = readBit(265, lane); // Decode ED
+    z.nCB = readBit(263, lane); // Decode CB
+}
+
+//=============================================================================
+// PER-LANE ENVIRONMENT (TRICKBOX)
+//=============================================================================
+
+void ClassSimZ80_Batch::laneStop(uint lane, const char *reason)
+{
+    m_lane[lane].stopped = true;
+    qInfo() << "Batch: lane" << lane << "stopped at hcycle" << m_lane[lane].hcycle << reason;
+}
+
+/*
+ * Writes to the lane's simulated RAM, handling its trickbox control area the same way ClassTrickbox does
+ */
+void ClassSimZ80_Batch::laneWriteMem(uint lane, uint16_t ab, uint8_t db)
+{
+    BatchLane &l = m_lane[lane];
+    if (ab >= m_rom)
+        l.mem[ab] = db;
+    if ((ab >= TRICKBOX_START) && (ab <= TRICKBOX_END))
+    {
+        if ((ab & ~1) == TRICKBOX_START)
+            return laneStop(lane, "tb_stop");
+        l.trickWriteEven = ab & 1;
+        if (!l.trickWriteEven)
+            return;
+        for (uint i = 0; i < MAX_PIN_CTRL; i++)
+            if (l.tb->pinCtrl[i].atCycle && (l.tb->pinCtrl[i].atCycle <= l.hcycle))
+                return laneStop(lane, "pin control cycle already passed");
+        if (l.tb->cycleStop && (l.tb->cycleStop <= l.hcycle))
+            return laneStop(lane, "stop cycle already passed");
+    }
+}
+
+void ClassSimZ80_Batch::laneWriteIO(uint lane, uint16_t ab, uint8_t db)
+{
+    BatchLane &l = m_lane[lane];
+    if ((ab & 0xFE) == 0x80)
+        ab &= 0xFF;
+    l.mio[ab] = db;
+    if ((ab == 0x80) && (db != 10)) // Console output ignores LF in CR/LF sequence
+    {
+        if (db == 0x04)
+            laneStop(lane, "CHAR(EOT)");
+        else
+            l.console.append(QChar(db));
+    }
+}
+
+/*
+ * Per-lane counterpart of ClassTrickbox::onTick(): collects the pins to assert or release in each lane
+ */
+void ClassSimZ80_Batch::laneTick(uint lane, uint64_t assert[MAX_PIN_CTRL], uint64_t release[MAX_PIN_CTRL])
+{
+    BatchLane &l = m_lane[lane];
+    const uint ticks = l.hcycle;
+    l.tb->curCycle = ticks;
+    if (!l.trickWriteEven)
+        return;
+    if ((l.tb->cycleStop > 0) && (l.tb->cycleStop == ticks))
+        return laneStop(lane, "at cycleStop");
+
+    bool anyPC = false;
+    for (uint i = 0; i < MAX_PIN_CTRL; i++)
+        anyPC |= !!l.tb->pinCtrl[i].atPC;
+    const uint16_t pc = anyPC ? readValue(n_pc, 16, lane) : 0;
+
+    const uint64_t bit = 1ULL << lane;
+    for (uint i = 0; i < MAX_PIN_CTRL; i++)
+    {
+        auto &ctrl = l.tb->pinCtrl[i];
+        if (pc && (pc == ctrl.atPC))
+        {
+            ctrl.atCycle = ticks;
+            ctrl.atPC = 0;
+        }
+        if ((ctrl.atCycle == 0) || (ctrl.atCycle > ticks))
+            continue;
+        if (ctrl.atCycle == ticks)
+            assert[i] |= bit;
+        else if (ctrl.hold > 0)
+        {
+            ctrl.hold--;
+            if (ctrl.hold == 0)
+            {
+                release[i] |= bit;
+                ctrl.atCycle = 0;
+                ctrl.hold = TRICKBOX_PIN_HOLD;
+            }
+        }
+    }
+}
+
+//=============================================================================
+// SCRIPTING INTERFACE
+//=============================================================================
+
+void ClassSimZ80_Batch::stopAt(quint16 hcycle)
+{
+    for (uint i = 0; i < m_lanes; i++)
+        m_lane[i].tb->cycleStop = hcycle;
+}
+
+void ClassSimZ80_Batch::setAt(uint lane, QString pin, quint16 hcycle, quint16 hold)
+{
+    int i = pins.indexOf(pin);
+    if ((i >= 0) && (lane < m_lanes))
+    {
+        m_lane[lane].tb->pinCtrl[i].atCycle = hcycle;
+        m_lane[lane].tb->pinCtrl[i].atPC = 0;
+        m_lane[lane].tb->pinCtrl[i].hold = hold;
+    }
+    else
+        qWarning() << "Invalid lane or pin name. Only these pins can be set:" << pins;
+}
+
+void ClassSimZ80_Batch::setAtPC(uint lane, QString pin, quint16 addr, quint16 hold)
+{
+    int i = pins.indexOf(pin);
+    if ((i >= 0) && (lane < m_lanes))
+    {
+        m_lane[lane].tb->pinCtrl[i].atCycle = 0;
+        m_lane[lane].tb->pinCtrl[i].atPC = addr;
+        m_lane[lane].tb->pinCtrl[i].hold = hold;
+    }
+    else
+        qWarning() << "Invalid lane or pin name. Only these pins can be set:" << pins;
+}
+
+const QString ClassSimZ80_Batch::readState(uint lane)
+{
+    if (lane >= m_lanes)
+        return {};
+    z80state z;
+    readState(z, lane);
+    return z80state::dumpState(z) % QString("hcycle:%1%2\n").arg(m_lane[lane].hcycle).arg(m_lane[lane].stopped ? " (stopped)" : "");
+}
+
+const QString ClassSimZ80_Batch::getOutput(uint lane)
+{
+    return (lane < m_lanes) ? m_lane[lane].console : QString();
+}
+
+/*
+ * Returns the same hash of the net states as ClassSimZ80_AVX2::getStateHash(), so a lane can be checked against a run
+ * of the optimized simulator with the same stimulus; as a hex string, since a script number can't hold 64 bits
+ */
+const QString ClassSimZ80_Batch::getStateHash(uint lane)
+{
+    if (lane >= m_lanes)
+        return QString();
+    quint64 hash = 0xCBF29CE484222325ULL; // FNV-1a
+    for (net_t n = 0; n < MAX_NETS; n++)
+        hash = (hash ^ ((m_netlist[n].state >> lane) & 1)) * 0x100000001B3ULL;
+    return QString::number(hash, 16);
+}
+
+uint ClassSimZ80_Batch::getHCycle(uint lane)
+{
+    return (lane < m_lanes) ? m_lane[lane].hcycle : 0;
+}
+
+quint8 ClassSimZ80_Batch::readMem(uint lane, quint16 ab)
+{
+    return (lane < m_lanes) ? m_lane[lane].mem[ab] : 0;
+}
@@ -0,0 +1,133 @@
+#ifndef CLASSSIMZ80_BATCH_H
+#define CLASSSIMZ80_BATCH_H
+
+#include "AppTypes.h"
+#include "ClassTrickbox.h"
+#include "z80state.h"
+#include <QAtomicInteger>
+#include <QHash>
+#include <QVector>
+
+#define MAX_LANES 64
+
+class ClassSimZ80_AVX2;
+
+// Net of the batch simulator: every state bit is a mask with one bit per chip instance (lane)
+struct NetBatch
+{
+    QVector<tran_t> gates;              // Transistors for which this net is a gate
+    QVector<tran_t> c1c2s;              // Transistors for which this net is either a source or a drain
+    uint64_t state {};                  // The voltage on the net is high, per lane
+    uint64_t isHigh {};                 // Net is being pulled high, per lane
+    uint64_t isLow {};                  // Net is being pulled low, per lane
+    bool floats {};                     // Net can float (hi-Z)
+    bool hasPullup {};                  // Net has a (permanent) pull-up resistor
+};
+
+// Environment of a single lane: its own RAM, IO space and a trickbox control area overlaid on its RAM
+struct BatchLane
+{
+    uint8_t mem[65536];                 // Simulated 64K memory
+    uint8_t mio[65536];                 // Simulated 64K IO space
+    trick *tb;                          // Trickbox control area at TRICKBOX_START in this lane's memory
+    bool trickWriteEven {true};         // Even/odd write address to the control area
+    bool stopped {};                    // The lane hit one of its stop conditions
+    uint hcycle {};                     // Half-cycle count since the reset
+    QString console;                    // Characters written to the console IO port
+};
+
+/*
+ * ClassSimZ80_Batch runs up to 64 independent Z80 chip instances in one pass over the netlist
+ * Each net state and each transistor state is a 64-bit mask, one bit per instance (lane). Lanes share
+ * the netlist but have their own memory, IO space and trickbox pin control, so a sweep over stimulus
+ * variants (ex. different int, wait or busrq timings) costs about as much as a single run.
+ */
+class ClassSimZ80_Batch : public QObject
+{
+    Q_OBJECT                                //* <- Methods of the scripting object "batch" below
+public:
+    explicit ClassSimZ80_Batch();
+    ~ClassSimZ80_Batch();
+
+    bool loadNetlist(ClassSimZ80_AVX2 &sim);// Copies the netlist topology from the (already loaded) optimized simulator
+    void runBlocking(uint hcycles);         // Runs all lanes in the calling thread until they stop or hcycles have passed
+    void readState(z80state &z, uint lane); // Reads the chip state of a lane into a state structure
+
+public slots:
+    bool init(uint lanes);                  //* Resets all lanes; each lane gets a copy of the simulated RAM and IO
+    void run(uint hcycles);                 //* Runs all lanes for the given number of half-cycles in a background thread
+    void stop() { m_runcount = 0; }         //* Stops the running batch
+    bool isRunning() { return m_runcount; } //* Returns true while the batch is running
+    void stopAt(quint16 hcycle);            //* Stops every lane at the given hcycle
+    void setAt(uint lane, QString pin, quint16 hcycle, quint16 hold); //* Activates a named pin at hcycle in one lane
+    void setAtPC(uint lane, QString pin, quint16 addr, quint16 hold); //* Activates a named pin when PC equals addr in one lane
+    const QString readState(uint lane);     //* Returns the chip state of a lane as a decoded string
+    const QString getOutput(uint lane);     //* Returns the console output of a lane
+    uint getHCycle(uint lane);              //* Returns the current half-cycle of a lane
+    quint8 readMem(uint lane, quint16 ab);  //* Reads from a lane's simulated RAM
+    uint getLanes() { return m_lanes; }     //* Returns the number of lanes
+    uint getEstHz() { return m_estHz; }     //* Returns the simulated frequency of the last run, per lane
+    const QString getStateHash(uint lane);  //* Returns a hash of the net states of a lane (hex), as the optimized simulator does
+
+private:
+    //----------------------- Simulator ------------------------
+    void doReset();
+    void halfCycle();
+    void set(net_t n, uint64_t high, uint64_t lanes) { set(&n, &high, &lanes, 1); } // Pulls a net high or low in the selected lanes
+    void set(const net_t *nets, const uint64_t *high, const uint64_t *lanes, uint count); // Pulls the nets together
+    void recalcNetlist();
+    void recalcNet(net_t n, uint64_t lanes);
+    void addRecalcNet(net_t n, uint64_t lanes);
+    void addNetToGroup(net_t n, uint64_t lanes);
+    bool getLaneValue(net_t n, uint lane);
+    void addNetToLaneGroup(net_t n, uint lane);
+    void allNets();
+    uint64_t readMask(net_t n);             // Returns the net state in every lane, hi-Z reads as 1
+    pin_t readBit(net_t n, uint lane);      // Returns the net state in a lane: 0, 1 or 2 (hi-Z)
+    uint readValue(const net_t *nets, uint count, uint lane); // Assembles bits of a lane into a value
+    uint8_t readByte(const QString &name, uint lane);
+
+    //------------------- Per-lane environment -----------------
+    void laneWriteMem(uint lane, uint16_t ab, uint8_t db);
+    void laneWriteIO(uint lane, uint16_t ab, uint8_t db);
+    void laneTick(uint lane, uint64_t assert[MAX_PIN_CTRL], uint64_t release[MAX_PIN_CTRL]);
+    void laneStop(uint lane, const char *reason);
+
+    QVector<NetBatch> m_netlist;
+    uint64_t m_transOn[MAX_TRANS] {};   // Transistor on-state, per lane
+    net_t m_transC1[MAX_TRANS] {};
+    net_t m_transC2[MAX_TRANS] {};
+    uint16_t m_gatesCount[MAX_NETS] {}; // Number of gates of each net, decides the value of a floating group
+    net_t ngnd {1}, npwr {2}, nclk {3};
+    net_t n_rfsh, n_m1, n_mreq, n_rd, n_wr, n_iorq, n_t2, n_t3;
+    net_t n_db[8], n_ab[16], n_pc[16];
+    net_t n_pins[MAX_PIN_CTRL];         // _int, _nmi, _busrq, _wait, _reset
+    QHash<QString, net_t> m_netnums;
+
+    // Nets to recalculate and the lanes to recalculate them in; a net queued again by other lanes, after other nets,
+    // gets another entry, so that each lane sees its nets in the same order as a scalar simulator would
+    QVector<net_t> m_list, m_recalcList;
+    QVector<uint64_t> m_listLanes, m_recalcListLanes;
+    uint64_t m_recalcLanes[MAX_NETS] {};// Lanes in which a net is already in m_recalcList
+
+    // Group of a single lane, collected in the order of the scalar simulators (power net at position 0)
+    QVector<net_t> m_laneGroup;
+    uint64_t m_laneBitset[(MAX_NETS + 63) / 64] {};
+
+    // Union (over the lanes being recalculated) of the group being resolved, and its edges; reach[i] holds the lanes in which
+    // the group member i is connected to the net that is being recalculated
+    struct Edge { uint16_t a, b; tran_t t; };
+    QVector<net_t> m_group;
+    QVector<Edge> m_edges;
+    QVector<uint64_t> m_reach;
+    QVector<uint16_t> m_byGates;        // Group members ordered by the decreasing number of gates
+    int16_t m_groupIdx[MAX_NETS];       // Net's index in m_group, -1 if not in the group
+
+    BatchLane *m_lane {};
+    uint m_lanes {};
+    uint m_rom {};                      // Read-only initial memory block (copied from the trickbox at init)
+    QAtomicInt m_runcount {};
+    uint m_estHz {};
+};
+
+#endif // CLASSSIMZ80_BATCH_H
@@ -0,0 +1,116 @@
+#include "ClassSimZ80_Compiled.h"
+
+bool ClassSimZ80_Compiled::loadResources(const QString dir)
+{
+    if (!ClassSimZ80_AVX2::loadResources(dir))
+        return false;
+    m_compiled = verifyNetlist();
+    if (m_compiled)
+        qInfo() << "Using the compiled netlist";
+    else
+        qWarning() << "The netlist in" << dir << "does not match the compiled netlist; using the optimized simulator";
+    return true;
+}
+
+/*
+ * The reduced netlist no longer matches the compiled one, which keeps the transistors that the constant nets fold away
+ */
+bool ClassSimZ80_Compiled::loadConstants(const QString &fileName, bool observed)
+{
+    if (!ClassSimZ80_AVX2::loadConstants(fileName, observed))
+        return false;
+    if (m_compiled)
+        qInfo() << "Using the reduced netlist instead of the compiled netlist";
+    m_compiled = false;
+    return true;
+}
+
+/*
+ * Compares the loaded netlist with the one the code was compiled from: the transistors, the order of every adjacency
+ * row (it decides the order of the group search) and gate list, the pull-ups and the component bitset words
+ */
+bool ClassSimZ80_Compiled::verifyNetlist()
+{
+    typedef CompiledNetlist N;
+    for (tran_t t = 0; t < MAX_TRANS; t++)
+    {
+        if ((m_transGate[t] != N::transGate[t]) || (m_transC1[t] != N::transC1[t]) || (m_transC2[t] != N::transC2[t]))
+            return false;
+    }
+    for (net_t n = 0; n < MAX_NETS; n++)
+    {
+        const NetAVX2 &net = m_netlist[n];
+        if ((net.c1c2sCount != N::edgeStart[n + 1] - N::edgeStart[n]) || (net.gatesCount != N::fanoutStart[n + 1] - N::fanoutStart[n]))
+            return false;
+        for (uint i = 0; i < net.c1c2sCount; i++)
+        {
+            const NetEdge &e = N::edges[N::edgeStart[n] + i];
+            if ((net.c1c2s[i].t != e.t) || (net.c1c2s[i].other != e.other))
+                return false;
+        }
+        for (uint i = 0; i < net.gatesCount; i++)
+        {
+            if (net.gatesTrans[i] != N::fanout[N::fanoutStart[n] + i].t)
+                return false;
+        }
+        if ((net.hasPullup != N::pullup[n]) || (m_cccWordMask[net.ccc] != N::cccWords[n]))
+            return false;
+    }
+    return true;
+}
+
+//=============================================================================
+// CORE SIMULATION - THE EVALUATION OF ClassSimZ80_AVX2 OVER THE COMPILED NETLIST
+//=============================================================================
+
+/*
+ * Topology of the compiled netlist for the shared evaluation (ClassSimZ80_AVX2::recalcNet()): the generated group
+ * search, and the gate fanout table, which holds the source and drain of each transistor next to it. The generated
+ * search resolves the nets of the static gates as well.
+ */
+struct ClassSimZ80_Compiled::CompiledTopology
+{
+    static SIM_INLINE void getNetGroup(ClassSimZ80_AVX2 &s, net_t n) { static_cast<ClassSimZ80_Compiled &>(s).getNetGroup(n); }
+    static SIM_INLINE bool getGateGroup(ClassSimZ80_AVX2 &, net_t, bool &) { return false; }
+    template <typename Flip> static SIM_INLINE void forGates(ClassSimZ80_AVX2 &, net_t n, Flip flip)
+    {
+        const GateEdge* g = CompiledNetlist::fanout + CompiledNetlist::fanoutStart[n];
+        const GateEdge* gEnd = CompiledNetlist::fanout + CompiledNetlist::fanoutStart[n + 1];
+        for (; g < gEnd; g++)
+            flip(g->t, g->c1, g->c2);
+    }
+};
+
+void ClassSimZ80_Compiled::recalcNetlist()
+{
+    if (!m_compiled)
+        return ClassSimZ80_AVX2::recalcNetlist();
+    recalcWaves<CompiledTopology>();
+}
+
+SIM_INLINE void ClassSimZ80_Compiled::getNetGroup(net_t n)
+{
+    const CompiledNetlist::Fn search = CompiledNetlist::group[n];
+    if (search)
+    {
+        search(*this);
+        return;
+    }
+
+    // The net is alone in its component: the group is the net itself and the power nets it connects to
+    m_group[0] = n;
+    m_groupIndex = 1;
+    const NetEdge* e = CompiledNetlist::edges + CompiledNetlist::edgeStart[n];
+    const NetEdge* eEnd = CompiledNetlist::edges + CompiledNetlist::edgeStart[n + 1];
+    for (; e < eEnd; e++)
+    {
+        if (!testBit(m_transOn, e->t))
+            continue;
+        const net_t other = e->other;
+        if ((other == n) || (other == m_group[0]) || ((m_groupIndex > 2) && (other == m_group[2])))
+            continue;
+        m_group[m_groupIndex] = other;
+        std::swap(m_group[0], m_group[m_groupIndex]);
+        m_groupIndex++;
+    }
+}
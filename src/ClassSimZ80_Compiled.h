@@ -0,0 +1,104 @@
+#ifndef CLASSSIMZ80_COMPILED_H
+#define CLASSSIMZ80_COMPILED_H
+
+#include "ClassSimZ80_AVX2.h"
+
+// Gate fanout entry of a net: a transistor that the net switches, with its source and drain
+struct GateEdge
+{
+    tran_t t;                   // Transistor index
+    net_t c1;                   // Source net
+    net_t c2;                   // Drain net
+};
+
+/*
+ * ClassSimZ80_Compiled is the optimized simulator with the netlist topology compiled in
+ * At build time, NetlistCompiler (tools/) turns the netlist resources into a straight-line group search for the nets
+ * of every multi-net component, with all transistor and net numbers as constants, and into constant adjacency and
+ * gate fanout tables. They replace the walks through the NetAVX2 gatesTrans and c1c2s pointers; everything else,
+ * including the group cache, is inherited. If the netlist loaded at runtime is not the one the code was compiled
+ * from, the inherited simulation is used.
+ */
+class ClassSimZ80_Compiled : public ClassSimZ80_AVX2
+{
+    Q_OBJECT
+
+public:
+    explicit ClassSimZ80_Compiled() {};
+
+    bool loadResources(const QString dir);  // Loads the netlist and verifies that it matches the compiled one
+    bool loadConstants(const QString &fileName, bool observed = false); // Reduces the netlist; the inherited simulation runs it
+    bool isCompiled() { return m_compiled; } // Returns true if the compiled code runs the simulation
+
+protected:
+    void recalcNetlist() override;
+
+private:
+    friend struct CompiledNetlist;
+    struct CompiledTopology;
+    SIM_INLINE void getNetGroup(net_t n);
+    bool verifyNetlist();
+
+    bool m_compiled {};                     // The loaded netlist matches the compiled one
+};
+
+/*
+ * Code and tables generated from the netlist (ClassSimZ80_Netlist.cpp in the build directory)
+ * The inline primitives below are the building blocks of the generated code, which calls them with constants.
+ */
+struct CompiledNetlist
+{
+    typedef ClassSimZ80_Compiled S;
+    typedef void (*Fn)(S &s);
+    static const Fn group[MAX_NETS];        // Resolves the group of a net into m_group; null for a net alone in its component
+
+    static const uint32_t edgeStart[MAX_NETS + 1];  // Start of each net's adjacency row in edges[]
+    static const NetEdge edges[];
+    static const uint32_t fanoutStart[MAX_NETS + 1];// Start of each net's gate fanout in fanout[]
+    static const GateEdge fanout[];
+
+    // Topology the code was compiled from, checked against the loaded netlist
+    static const net_t transGate[MAX_TRANS];
+    static const net_t transC1[MAX_TRANS];  // Normalized the same way as the loaded netlist
+    static const net_t transC2[MAX_TRANS];
+    static const uint64_t cccWords[MAX_NETS]; // Group bitset words of the net's channel-connected component
+    static const bool pullup[MAX_NETS];
+
+    static SIM_INLINE bool on(S &s, tran_t t) { SIM_PERF(s.m_perf.groupVisits++); return S::testBit(s.m_transOn, t); }
+    static SIM_INLINE void clear(S &s, uint word) { s.m_groupBitset[word] = 0; }
+
+    // Adds the net that the search starts from
+    static SIM_INLINE void start(S &s, net_t n)
+    {
+        s.setBit(s.m_groupBitset, n);
+        s.m_group[0] = n;
+        s.m_groupIndex = 1;
+    }
+
+    // Adds a net to the group, returns false if it is already there
+    static SIM_INLINE bool visit(S &s, net_t n)
+    {
+        uint64_t &word = s.m_groupBitset[n >> 6];
+        const uint64_t mask = 1ULL << (n & 63);
+        if (word & mask)
+            return false;
+        word |= mask;
+        s.m_group[s.m_groupIndex++] = n;
+        return true;
+    }
+
+    // Adds a power net to the group; power nets go at position 0 for fast detection
+    static SIM_INLINE void visitPower(S &s, net_t n)
+    {
+        uint64_t &word = s.m_groupBitset[0];
+        const uint64_t mask = 1ULL << n;
+        if (word & mask)
+            return;
+        word |= mask;
+        s.m_group[s.m_groupIndex] = n;
+        std::swap(s.m_group[0], s.m_group[s.m_groupIndex]);
+        s.m_groupIndex++;
+    }
+};
+
+#endif // CLASSSIMZ80_COMPILED_H
@@ -0,0 +1,962 @@
+#include "ClassSimZ80_Emu.h"
+#include "ClassController.h"
+#include <utility>
+
+// Flag bits of the F register
+enum : uint8_t { FC = 0x01, FN = 0x02, FP = 0x04, FX = 0x08, FH = 0x10, FY = 0x20, FZ = 0x40, FS = 0x80 };
+
+// S, Z, Y and X flags of a result, and the same with the parity flag
+static const struct FlagTables
+{
+    uint8_t sz53[256], sz53p[256];
+    FlagTables()
+    {
+        for (uint v = 0; v < 256; v++)
+        {
+            uint p = v ^ (v >> 4);
+            p ^= p >> 2;
+            p ^= p >> 1;
+            sz53[v] = (v & (FS | FY | FX)) | (v ? 0 : FZ);
+            sz53p[v] = sz53[v] | ((p & 1) ? 0 : FP);
+        }
+    }
+} tables;
+
+static inline uint8_t parity(uint8_t v) { return tables.sz53p[v] & FP; }
+
+/*
+ * Sets the registers to their values after a chip reset; the undefined ones are set to all ones
+ */
+void ClassSimZ80_Emu::reset()
+{
+    a = f = b = c = d = e = h = l = 0xFF;
+    a2 = f2 = b2 = c2 = d2 = e2 = h2 = l2 = 0xFF;
+    ix = iy = sp = 0xFFFF;
+    pc = wz = 0;
+    i = r = 0;
+    iff1 = iff2 = false;
+    im = 0;
+    halted = stopped = false;
+    tstates = 0;
+    m_q = 0;
+}
+
+/*
+ * Runs until the T-state count or the PC address (if not -1) is reached, whichever comes first
+ * Also stops at a HALT instruction, without executing it, since only an interrupt could continue past it, and when the
+ * program asks the trickbox to stop the simulation. Returns the T-state count.
+ */
+quint64 ClassSimZ80_Emu::run(quint64 maxTstates, int stopPc)
+{
+    stopped = false;
+    while ((tstates < maxTstates) && !stopped && (int(pc) != stopPc))
+    {
+        if (rd(pc) == 0x76)
+        {
+            halted = true;
+            break;
+        }
+        step();
+    }
+    return tstates;
+}
+
+/*
+ * Reads the registers into a state structure
+ */
+void ClassSimZ80_Emu::readState(z80state &z)
+{
+    z.af = (a << 8) | f;
+    z.bc = (b << 8) | c;
+    z.de = (d << 8) | e;
+    z.hl = (h << 8) | l;
+    z.af2 = (a2 << 8) | f2;
+    z.bc2 = (b2 << 8) | c2;
+    z.de2 = (d2 << 8) | e2;
+    z.hl2 = (h2 << 8) | l2;
+    z.ix = ix;
+    z.iy = iy;
+    z.sp = sp;
+    z.ir = (i << 8) | r;
+    z.wz = wz;
+    z.pc = pc;
+}
+
+/*
+ * Sets the registers from a state structure
+ */
+void ClassSimZ80_Emu::setState(const z80state &z)
+{
+    a = z.af >> 8; f = z.af & 0xFF;
+    b = z.bc >> 8; c = z.bc & 0xFF;
+    d = z.de >> 8; e = z.de & 0xFF;
+    h = z.hl >> 8; l = z.hl & 0xFF;
+    a2 = z.af2 >> 8; f2 = z.af2 & 0xFF;
+    b2 = z.bc2 >> 8; c2 = z.bc2 & 0xFF;
+    d2 = z.de2 >> 8; e2 = z.de2 & 0xFF;
+    h2 = z.hl2 >> 8; l2 = z.hl2 & 0xFF;
+    ix = z.ix;
+    iy = z.iy;
+    sp = z.sp;
+    i = z.ir >> 8; r = z.ir & 0xFF;
+    wz = z.wz;
+    pc = z.pc;
+}
+
+/*
+ * Executes one instruction, returns the number of T-states it took
+ * The index prefixes are executed along with the instruction they modify
+ */
+uint ClassSimZ80_Emu::step()
+{
+    m_t = 0;
+    m_idx = 0;
+    m_addrValid = false;
+    m_flagsSet = false;
+    if (halted) // HALT executes NOPs
+    {
+        r = (r & 0x80) | ((r + 1) & 0x7F);
+        m_t = 4;
+    }
+    else
+    {
+        uint8_t op = fetch();
+        while ((op == 0xDD) || (op == 0xFD)) // Only the last one of several index prefixes counts
+        {
+            m_idx = (op == 0xDD) ? 1 : 2;
+            m_t += 4;
+            op = fetch();
+        }
+        if (op == 0xED)
+        {
+            m_idx = 0;
+            execED();
+        }
+        else if (op == 0xCB)
+            m_idx ? execIndexCB() : execCB();
+        else
+            exec(op);
+    }
+    m_q = m_flagsSet ? f : 0;
+    tstates += m_t;
+    return m_t;
+}
+
+//=============================================================================
+// MEMORY, IO AND REGISTER ACCESS
+//=============================================================================
+
+uint8_t ClassSimZ80_Emu::fetch()
+{
+    r = (r & 0x80) | ((r + 1) & 0x7F);
+    return rd(pc++);
+}
+
+uint8_t ClassSimZ80_Emu::rd(uint16_t addr)
+{
+    return ::controller.readMem(addr);
+}
+
+void ClassSimZ80_Emu::wr(uint16_t addr, uint8_t v)
+{
+    ::controller.writeMem(addr, v);
+    if ((addr & ~1) == TRICKBOX_START) // Writing to the trickbox "stop" word stops the simulation
+        stopped = ::controller.getTrickbox().property("enabled").toBool();
+}
+
+uint8_t ClassSimZ80_Emu::in(uint16_t addr)
+{
+    return ::controller.readIO(addr);
+}
+
+void ClassSimZ80_Emu::out(uint16_t addr, uint8_t v)
+{
+    ::controller.writeIO(addr, v);
+    if (((addr & 0xFF) == 0x80) && (v == 0x04)) // Console output of EOT stops the simulation
+        stopped = ::controller.getTrickbox().property("enabled").toBool();
+}
+
+uint16_t ClassSimZ80_Emu::getRP(uint p)
+{
+    switch (p)
+    {
+        case 0: return (b << 8) | c;
+        case 1: return (d << 8) | e;
+        case 2: return getHL();
+        default: return sp;
+    }
+}
+
+void ClassSimZ80_Emu::setRP(uint p, uint16_t v)
+{
+    switch (p)
+    {
+        case 0: b = v >> 8; c = v & 0xFF; break;
+        case 1: d = v >> 8; e = v & 0xFF; break;
+        case 2: setHL(v); break;
+        default: sp = v; break;
+    }
+}
+
+void ClassSimZ80_Emu::setRP2(uint p, uint16_t v)
+{
+    if (p == 3) // POP AF does not count as setting the flags
+    {
+        a = v >> 8;
+        f = v & 0xFF;
+    }
+    else
+        setRP(p, v);
+}
+
+uint8_t ClassSimZ80_Emu::getR(uint n)
+{
+    switch (n)
+    {
+        case 0: return b;
+        case 1: return c;
+        case 2: return d;
+        case 3: return e;
+        case 4: return (m_idx == 1) ? (ix >> 8) : (m_idx == 2) ? (iy >> 8) : h;
+        case 5: return (m_idx == 1) ? (ix & 0xFF) : (m_idx == 2) ? (iy & 0xFF) : l;
+        case 6: return rd(addrHL());
+        default: return a;
+    }
+}
+
+void ClassSimZ80_Emu::setR(uint n, uint8_t v)
+{
+    switch (n)
+    {
+        case 0: b = v; break;
+        case 1: c = v; break;
+        case 2: d = v; break;
+        case 3: e = v; break;
+        case 4:
+            if (m_idx == 1) ix = (ix & 0xFF) | (v << 8);
+            else if (m_idx == 2) iy = (iy & 0xFF) | (v << 8);
+            else h = v;
+            break;
+        case 5:
+            if (m_idx == 1) ix = (ix & 0xFF00) | v;
+            else if (m_idx == 2) iy = (iy & 0xFF00) | v;
+            else l = v;
+            break;
+        case 6: wr(addrHL(), v); break;
+        default: a = v; break;
+    }
+}
+
+void ClassSimZ80_Emu::setHL(uint16_t v)
+{
+    if (m_idx == 1)
+        ix = v;
+    else if (m_idx == 2)
+        iy = v;
+    else
+    {
+        h = v >> 8;
+        l = v & 0xFF;
+    }
+}
+
+// With an index prefix, reads the displacement once per instruction; it takes 8 more T-states than (HL)
+uint16_t ClassSimZ80_Emu::addrHL()
+{
+    if (!m_idx)
+        return (h << 8) | l;
+    if (!m_addrValid)
+    {
+        m_addr = getHL() + int8_t(imm8());
+        m_addrValid = true;
+        wz = m_addr;
+        m_t += 8;
+    }
+    return m_addr;
+}
+
+bool ClassSimZ80_Emu::cond(uint cc)
+{
+    static const uint8_t mask[4] = { FZ, FC, FP, FS }; // NZ Z, NC C, PO PE, P M
+    return bool(f & mask[cc >> 1]) == bool(cc & 1);
+}
+
+//=============================================================================
+// ARITHMETIC AND LOGIC
+//=============================================================================
+
+void ClassSimZ80_Emu::alu(uint op, uint8_t v)
+{
+    switch (op)
+    {
+        case 0: // ADD
+        case 1: // ADC
+        {
+            const uint res = a + v + ((op == 1) ? (f & FC) : 0);
+            setF(tables.sz53[res & 0xFF] | ((a ^ v ^ res) & FH) | (((a ^ ~v) & (a ^ res) & 0x80) >> 5) | ((res >> 8) & FC));
+            a = res & 0xFF;
+            break;
+        }
+        case 2: // SUB
+        case 3: // SBC
+        case 7: // CP
+        {
+            const uint res = a - v - ((op == 3) ? (f & FC) : 0);
+            const uint8_t xy = (op == 7) ? (v & (FY | FX)) : (res & (FY | FX)); // CP takes them from the operand
+            setF((tables.sz53[res & 0xFF] & (FS | FZ)) | xy | FN | ((a ^ v ^ res) & FH) | (((a ^ v) & (a ^ res) & 0x80) >> 5) | ((res >> 8) & FC));
+            if (op != 7)
+                a = res & 0xFF;
+            break;
+        }
+        case 4: a &= v; setF(tables.sz53p[a] | FH); break;
+        case 5: a ^= v; setF(tables.sz53p[a]); break;
+        default: a |= v; setF(tables.sz53p[a]); break;
+    }
+}
+
+uint8_t ClassSimZ80_Emu::inc8(uint8_t v)
+{
+    const uint8_t res = v + 1;
+    setF((f & FC) | tables.sz53[res] | ((res & 0x0F) ? 0 : FH) | ((v == 0x7F) ? FP : 0));
+    return res;
+}
+
+uint8_t ClassSimZ80_Emu::dec8(uint8_t v)
+{
+    const uint8_t res = v - 1;
+    setF((f & FC) | FN | tables.sz53[res] | ((v & 0x0F) ? 0 : FH) | ((v == 0x80) ? FP : 0));
+    return res;
+}
+
+uint16_t ClassSimZ80_Emu::add16(uint16_t x, uint16_t y)
+{
+    const uint res = x + y;
+    wz = x + 1;
+    setF((f & (FS | FZ | FP)) | ((res >> 8) & (FY | FX)) | (((x ^ y ^ res) >> 8) & FH) | ((res >> 16) & FC));
+    return res & 0xFFFF;
+}
+
+void ClassSimZ80_Emu::adc16(uint16_t v)
+{
+    const uint hl = (h << 8) | l;
+    const uint res = hl + v + (f & FC);
+    wz = hl + 1;
+    setF(((res >> 8) & (FS | FY | FX)) | ((res & 0xFFFF) ? 0 : FZ) | (((hl ^ v ^ res) >> 8) & FH) |
+         (((~(hl ^ v) & (hl ^ res)) >> 13) & FP) | ((res >> 16) & FC));
+    h = (res >> 8) & 0xFF;
+    l = res & 0xFF;
+}
+
+void ClassSimZ80_Emu::sbc16(uint16_t v)
+{
+    const uint hl = (h << 8) | l;
+    const uint res = hl - v - (f & FC);
+    wz = hl + 1;
+    setF(FN | ((res >> 8) & (FS | FY | FX)) | ((res & 0xFFFF) ? 0 : FZ) | (((hl ^ v ^ res) >> 8) & FH) |
+         ((((hl ^ v) & (hl ^ res)) >> 13) & FP) | ((res >> 16) & FC));
+    h = (res >> 8) & 0xFF;
+    l = res & 0xFF;
+}
+
+uint8_t ClassSimZ80_Emu::rot(uint op, uint8_t v)
+{
+    uint8_t res, carry;
+    switch (op)
+    {
+        case 0: carry = v >> 7; res = (v << 1) | carry; break;              // RLC
+        case 1: carry = v & 1; res = (v >> 1) | (carry << 7); break;        // RRC
+        case 2: carry = v >> 7; res = (v << 1) | (f & FC); break;           // RL
+        case 3: carry = v & 1; res = (v >> 1) | ((f & FC) << 7); break;     // RR
+        case 4: carry = v >> 7; res = v << 1; break;                        // SLA
+        case 5: carry = v & 1; res = (v >> 1) | (v & 0x80); break;          // SRA
+        case 6: carry = v >> 7; res = (v << 1) | 1; break;                  // SLL (undocumented)
+        default: carry = v & 1; res = v >> 1; break;                        // SRL
+    }
+    setF(tables.sz53p[res] | carry);
+    return res;
+}
+
+void ClassSimZ80_Emu::daa()
+{
+    uint8_t adjust = 0, carry = f & FC;
+    if ((f & FH) || ((a & 0x0F) > 9))
+        adjust = 0x06;
+    if (carry || (a > 0x99))
+    {
+        adjust |= 0x60;
+        carry = FC;
+    }
+    const uint8_t res = (f & FN) ? (a - adjust) : (a + adjust);
+    setF(tables.sz53p[res] | ((a ^ res) & FH) | (f & FN) | carry);
+    a = res;
+}
+
+//=============================================================================
+// INSTRUCTION DECODE
+// The opcodes are decoded by their x, y, z, p and q fields: x = op[7:6], y = op[5:3], z = op[2:0], p = y[2:1], q = y[0]
+//=============================================================================
+
+void ClassSimZ80_Emu::exec(uint8_t op)
+{
+    const uint x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+    switch (x)
+    {
+    case 0:
+        switch (z)
+        {
+        case 0:
+            if (y == 0) // NOP
+                m_t += 4;
+            else if (y == 1) // EX AF,AF'
+            {
+                std::swap(a, a2);
+                std::swap(f, f2);
+                m_t += 4;
+            }
+            else // DJNZ, JR, JR cc
+            {
+                const int8_t disp = int8_t(imm8());
+                const bool jump = (y == 2) ? (--b != 0) : (y == 3) || cond(y - 4);
+                m_t += (y == 2) ? 8 : 7;
+                if (jump)
+                {
+                    pc += disp;
+                    wz = pc;
+                    m_t += 5;
+                }
+            }
+            break;
+        case 1:
+            if (q == 0) // LD rp,nn
+            {
+                setRP(p, imm16());
+                m_t += 10;
+            }
+            else // ADD HL,rp
+            {
+                setHL(add16(getHL(), getRP(p)));
+                m_t += 11;
+            }
+            break;
+        case 2:
+        {
+            const uint16_t addr = (p == 0) ? ((b << 8) | c) : (p == 1) ? ((d << 8) | e) : imm16();
+            switch (y)
+            {
+                case 0: // LD (BC),A
+                case 2: // LD (DE),A
+                case 6: // LD (nn),A
+                    wr(addr, a);
+                    wz = ((addr + 1) & 0xFF) | (a << 8);
+                    break;
+                case 1: // LD A,(BC)
+                case 3: // LD A,(DE)
+                case 7: // LD A,(nn)
+                    a = rd(addr);
+                    wz = addr + 1;
+                    break;
+                case 4: // LD (nn),HL
+                    wr(addr, getHL() & 0xFF);
+                    wr(addr + 1, getHL() >> 8);
+                    wz = addr + 1;
+                    break;
+                default: // LD HL,(nn)
+                    setHL(rd(addr) | (rd(addr + 1) << 8));
+                    wz = addr + 1;
+                    break;
+            }
+            m_t += (p < 2) ? 7 : (p == 2) ? 16 : 13;
+            break;
+        }
+        case 3: // INC rp, DEC rp
+            setRP(p, getRP(p) + (q ? -1 : 1));
+            m_t += 6;
+            break;
+        case 4: // INC r
+            setR(y, inc8(getR(y)));
+            m_t += (y == 6) ? 11 : 4;
+            break;
+        case 5: // DEC r
+            setR(y, dec8(getR(y)));
+            m_t += (y == 6) ? 11 : 4;
+            break;
+        case 6: // LD r,n
+            if (y == 6)
+            {
+                const uint16_t addr = addrHL();
+                wr(addr, imm8());
+                m_t += m_idx ? 7 : 10; // The displacement and the operand reads overlap
+            }
+            else
+            {
+                setR(y, imm8());
+                m_t += 7;
+            }
+            break;
+        default:
+            switch (y)
+            {
+                case 0: // RLCA
+                {
+                    const uint8_t carry = a >> 7;
+                    a = (a << 1) | carry;
+                    setF((f & (FS | FZ | FP)) | (a & (FY | FX)) | carry);
+                    break;
+                }
+                case 1: // RRCA
+                {
+                    const uint8_t carry = a & 1;
+                    a = (a >> 1) | (carry << 7);
+                    setF((f & (FS | FZ | FP)) | (a & (FY | FX)) | carry);
+                    break;
+                }
+                case 2: // RLA
+                {
+                    const uint8_t carry = a >> 7;
+                    a = (a << 1) | (f & FC);
+                    setF((f & (FS | FZ | FP)) | (a & (FY | FX)) | carry);
+                    break;
+                }
+                case 3: // RRA
+                {
+                    const uint8_t carry = a & 1;
+                    a = (a >> 1) | ((f & FC) << 7);
+                    setF((f & (FS | FZ | FP)) | (a & (FY | FX)) | carry);
+                    break;
+                }
+                case 4: daa(); break;
+                case 5: // CPL
+                    a = ~a;
+                    setF((f & (FS | FZ | FP | FC)) | FH | FN | (a & (FY | FX)));
+                    break;
+                case 6: // SCF; the Y and X flags depend on whether the previous instruction set the flags
+                    setF((f & (FS | FZ | FP)) | FC | (((m_q ^ f) | a) & (FY | FX)));
+                    break;
+                default: // CCF
+                    setF((f & (FS | FZ | FP)) | ((f & FC) ? FH : FC) | (((m_q ^ f) | a) & (FY | FX)));
+                    break;
+            }
+            m_t += 4;
+            break;
+        }
+        break;
+    case 1:
+        if (op == 0x76) // HALT
+        {
+            halted = true;
+            pc--;
+            m_t += 4;
+        }
+        else if ((y == 6) || (z == 6)) // LD (HL),r and LD r,(HL); with an index prefix, H and L are not the index halves
+        {
+            const uint16_t addr = addrHL();
+            const uint idx = m_idx;
+            m_idx = 0;
+            if (y == 6)
+                wr(addr, getR(z));
+            else
+                setR(y, rd(addr));
+            m_idx = idx;
+            m_t += 7;
+        }
+        else // LD r,r'
+        {
+            setR(y, getR(z));
+            m_t += 4;
+        }
+        break;
+    case 2: // ALU A,r
+        alu(y, getR(z));
+        m_t += (z == 6) ? 7 : 4;
+        break;
+    default:
+        switch (z)
+        {
+        case 0: // RET cc
+            m_t += 5;
+            if (cond(y))
+            {
+                pc = wz = pop();
+                m_t += 6;
+            }
+            break;
+        case 1:
+            if (q == 0) // POP rp
+            {
+                setRP2(p, pop());
+                m_t += 10;
+            }
+            else if (p == 0) // RET
+            {
+                pc = wz = pop();
+                m_t += 10;
+            }
+            else if (p == 1) // EXX
+            {
+                std::swap(b, b2);
+                std::swap(c, c2);
+                std::swap(d, d2);
+                std::swap(e, e2);
+                std::swap(h, h2);
+                std::swap(l, l2);
+                m_t += 4;
+            }
+            else if (p == 2) // JP (HL)
+            {
+                pc = getHL();
+                m_t += 4;
+            }
+            else // LD SP,HL
+            {
+                sp = getHL();
+                m_t += 6;
+            }
+            break;
+        case 2: // JP cc,nn
+            wz = imm16();
+            if (cond(y))
+                pc = wz;
+            m_t += 10;
+            break;
+        case 3:
+            switch (y)
+            {
+                case 0: // JP nn
+                    pc = wz = imm16();
+                    m_t += 10;
+                    break;
+                case 2: // OUT (n),A
+                {
+                    const uint8_t n = imm8();
+                    out(n | (a << 8), a);
+                    wz = ((n + 1) & 0xFF) | (a << 8);
+                    m_t += 11;
+                    break;
+                }
+                case 3: // IN A,(n)
+                {
+                    const uint16_t port = imm8() | (a << 8);
+                    a = in(port);
+                    wz = port + 1;
+                    m_t += 11;
+                    break;
+                }
+                case 4: // EX (SP),HL
+                {
+                    const uint16_t v = rd(sp) | (rd(sp + 1) << 8);
+                    wr(sp + 1, getHL() >> 8);
+                    wr(sp, getHL() & 0xFF);
+                    setHL(v);
+                    wz = v;
+                    m_t += 19;
+                    break;
+                }
+                case 5: // EX DE,HL; not affected by the index prefixes
+                    std::swap(d, h);
+                    std::swap(e, l);
+                    m_t += 4;
+                    break;
+                case 6: // DI
+                    iff1 = iff2 = false;
+                    m_t += 4;
+                    break;
+                default: // EI
+                    iff1 = iff2 = true;
+                    m_t += 4;
+                    break;
+            }
+            break;
+        case 4: // CALL cc,nn
+            wz = imm16();
+            m_t += 10;
+            if (cond(y))
+            {
+                push(pc);
+                pc = wz;
+                m_t += 7;
+            }
+            break;
+        case 5:
+            if (q == 0) // PUSH rp
+            {
+                push(getRP2(p));
+                m_t += 11;
+            }
+            else // CALL nn
+            {
+                wz = imm16();
+                push(pc);
+                pc = wz;
+                m_t += 17;
+            }
+            break;
+        case 6: // ALU A,n
+            alu(y, imm8());
+            m_t += 7;
+            break;
+        default: // RST
+            push(pc);
+            pc = wz = y * 8;
+            m_t += 11;
+            break;
+        }
+        break;
+    }
+}
+
+void ClassSimZ80_Emu::execCB()
+{
+    const uint8_t op = fetch();
+    const uint x = op >> 6, y = (op >> 3) & 7, z = op & 7;
+    const uint8_t v = getR(z);
+    if (x == 1) // BIT; with (HL), the Y and X flags come from the internal WZ register
+    {
+        const uint8_t res = v & (1 << y);
+        const uint8_t xy = (z == 6) ? (wz >> 8) : v;
+        setF((f & FC) | FH | (res ? 0 : (FZ | FP)) | (res & FS) | (xy & (FY | FX)));
+        m_t += (z == 6) ? 12 : 8;
+        return;
+    }
+    setR(z, (x == 0) ? rot(y, v) : (x == 2) ? (v & ~(1 << y)) : (v | (1 << y)));
+    m_t += (z == 6) ? 15 : 8;
+}
+
+// DDCB and FDCB: the displacement comes before the opcode, and neither of them is read by an M1 cycle
+void ClassSimZ80_Emu::execIndexCB()
+{
+    const uint16_t addr = getHL() + int8_t(imm8());
+    const uint8_t op = imm8();
+    const uint x = op >> 6, y = (op >> 3) & 7, z = op & 7;
+    const uint8_t v = rd(addr);
+    wz = addr;
+    if (x == 1) // BIT
+    {
+        const uint8_t res = v & (1 << y);
+        setF((f & FC) | FH | (res ? 0 : (FZ | FP)) | (res & FS) | ((addr >> 8) & (FY | FX)));
+        m_t += 16;
+        return;
+    }
+    const uint8_t res = (x == 0) ? rot(y, v) : (x == 2) ? (v & ~(1 << y)) : (v | (1 << y));
+    wr(addr, res);
+    if (z != 6) // Undocumented: the result is also copied into a register
+    {
+        m_idx = 0;
+        setR(z, res);
+    }
+    m_t += 19;
+}
+
+void ClassSimZ80_Emu::execED()
+{
+    const uint8_t op = fetch();
+    const uint x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+    if ((x == 2) && (z <= 3) && (y >= 4)) // Block instructions
+    {
+        const int dir = (y & 1) ? -1 : 1;
+        const bool repeat = y >= 6;
+        if (z == 0) blockLD(dir, repeat);
+        else if (z == 1) blockCP(dir, repeat);
+        else if (z == 2) blockIN(dir, repeat);
+        else blockOUT(dir, repeat);
+        return;
+    }
+    if (x != 1) // Invalid ED opcodes execute as 2 NOPs
+    {
+        m_t += 8;
+        return;
+    }
+    const uint16_t bc = (b << 8) | c, hl = (h << 8) | l;
+    switch (z)
+    {
+    case 0: // IN r,(C); IN (C) only sets the flags
+    {
+        const uint8_t v = in(bc);
+        if (y != 6)
+            setR(y, v);
+        setF((f & FC) | tables.sz53p[v]);
+        wz = bc + 1;
+        m_t += 12;
+        break;
+    }
+    case 1: // OUT (C),r; OUT (C),0 on the NMOS chip
+        out(bc, (y == 6) ? 0 : getR(y));
+        wz = bc + 1;
+        m_t += 12;
+        break;
+    case 2: // SBC HL,rp and ADC HL,rp
+        q ? adc16(getRP(p)) : sbc16(getRP(p));
+        m_t += 15;
+        break;
+    case 3: // LD (nn),rp and LD rp,(nn)
+    {
+        const uint16_t addr = imm16();
+        if (q == 0)
+        {
+            wr(addr, getRP(p) & 0xFF);
+            wr(addr + 1, getRP(p) >> 8);
+        }
+        else
+            setRP(p, rd(addr) | (rd(addr + 1) << 8));
+        wz = addr + 1;
+        m_t += 20;
+        break;
+    }
+    case 4: // NEG
+    {
+        const uint8_t v = a;
+        a = 0;
+        alu(2, v);
+        m_t += 8;
+        break;
+    }
+    case 5: // RETN and RETI
+        iff1 = iff2;
+        pc = wz = pop();
+        m_t += 14;
+        break;
+    case 6: // IM 0, IM 0/1 (undocumented, acts as IM 0), IM 1, IM 2
+    {
+        static const uint8_t mode[4] = { 0, 0, 1, 2 };
+        im = mode[y & 3];
+        m_t += 8;
+        break;
+    }
+    default:
+        switch (y)
+        {
+            case 0: i = a; m_t += 9; break; // LD I,A
+            case 1: r = a; m_t += 9; break; // LD R,A
+            case 2: // LD A,I
+            case 3: // LD A,R
+                a = (y == 2) ? i : r;
+                setF((f & FC) | tables.sz53[a] | (iff2 ? FP : 0));
+                m_t += 9;
+                break;
+            case 4: // RRD
+            {
+                const uint8_t v = rd(hl);
+                wr(hl, (a << 4) | (v >> 4));
+                a = (a & 0xF0) | (v & 0x0F);
+                setF((f & FC) | tables.sz53p[a]);
+                wz = hl + 1;
+                m_t += 18;
+                break;
+            }
+            case 5: // RLD
+            {
+                const uint8_t v = rd(hl);
+                wr(hl, (v << 4) | (a & 0x0F));
+                a = (a & 0xF0) | (v >> 4);
+                setF((f & FC) | tables.sz53p[a]);
+                wz = hl + 1;
+                m_t += 18;
+                break;
+            }
+            default: m_t += 8; break; // NOP
+        }
+        break;
+    }
+}
+
+//=============================================================================
+// BLOCK INSTRUCTIONS
+// Each step of a repeating block instruction executes as an instruction of its own, which jumps back to itself
+//=============================================================================
+
+void ClassSimZ80_Emu::blockLD(int dir, bool repeat)
+{
+    const uint16_t hl = (h << 8) | l, de = (d << 8) | e;
+    const uint16_t bc = ((b << 8) | c) - 1;
+    const uint8_t v = rd(hl);
+    wr(de, v);
+    h = uint16_t(hl + dir) >> 8; l = uint8_t(hl + dir);
+    d = uint16_t(de + dir) >> 8; e = uint8_t(de + dir);
+    b = bc >> 8; c = bc & 0xFF;
+    const uint8_t n = v + a;
+    setF((f & (FS | FZ | FC)) | (bc ? FP : 0) | (n & FX) | ((n << 4) & FY));
+    m_t += 16;
+    if (repeat && bc)
+        blockRepeat();
+}
+
+void ClassSimZ80_Emu::blockCP(int dir, bool repeat)
+{
+    const uint16_t hl = (h << 8) | l;
+    const uint16_t bc = ((b << 8) | c) - 1;
+    const uint8_t v = rd(hl);
+    const uint8_t res = a - v;
+    const uint8_t hf = (a ^ v ^ res) & FH;
+    h = uint16_t(hl + dir) >> 8; l = uint8_t(hl + dir);
+    b = bc >> 8; c = bc & 0xFF;
+    wz += dir;
+    const uint8_t n = res - (hf ? 1 : 0);
+    setF((f & FC) | FN | (tables.sz53[res] & (FS | FZ)) | hf | (bc ? FP : 0) | (n & FX) | ((n << 4) & FY));
+    m_t += 16;
+    if (repeat && bc && res)
+        blockRepeat();
+}
+
+void ClassSimZ80_Emu::blockIN(int dir, bool repeat)
+{
+    const uint16_t hl = (h << 8) | l;
+    const uint16_t bc = (b << 8) | c;
+    const uint8_t v = in(bc);
+    wz = bc + dir;
+    b--;
+    wr(hl, v);
+    h = uint16_t(hl + dir) >> 8; l = uint8_t(hl + dir);
+    const uint k = v + uint8_t(c + dir);
+    setF(tables.sz53[b] | ((v >> 6) & FN) | ((k > 0xFF) ? (FH | FC) : 0) | parity((k & 7) ^ b));
+    m_t += 16;
+    if (repeat && b)
+        blockIORepeat(v);
+}
+
+void ClassSimZ80_Emu::blockOUT(int dir, bool repeat)
+{
+    const uint16_t hl = (h << 8) | l;
+    const uint8_t v = rd(hl);
+    b--;
+    const uint16_t bc = (b << 8) | c;
+    out(bc, v);
+    wz = bc + dir;
+    h = uint16_t(hl + dir) >> 8; l = uint8_t(hl + dir);
+    const uint k = v + l;
+    setF(tables.sz53[b] | ((v >> 6) & FN) | ((k > 0xFF) ? (FH | FC) : 0) | parity((k & 7) ^ b));
+    m_t += 16;
+    if (repeat && b)
+        blockIORepeat(v);
+}
+
+// A repeating step takes 5 more T-states; its Y and X flags come from the high byte of the PC
+void ClassSimZ80_Emu::blockRepeat()
+{
+    pc -= 2;
+    wz = pc + 1;
+    setF((f & ~(FY | FX)) | ((pc >> 8) & (FY | FX)));
+    m_t += 5;
+}
+
+// A repeating step of the IO block instructions also changes the H and P flags
+void ClassSimZ80_Emu::blockIORepeat(uint8_t v)
+{
+    blockRepeat();
+    uint8_t flags = f;
+    if (flags & FC)
+    {
+        flags &= ~FH;
+        if (v & 0x80)
+        {
+            flags ^= parity((b - 1) & 7) ^ FP;
+            flags |= ((b & 0x0F) == 0x00) ? FH : 0;
+        }
+        else
+        {
+            flags ^= parity((b + 1) & 7) ^ FP;
+            flags |= ((b & 0x0F) == 0x0F) ? FH : 0;
+        }
+    }
+    else
+        flags ^= parity(b & 7) ^ FP;
+    setF(flags);
+}
@@ -0,0 +1,84 @@
+#ifndef CLASSSIMZ80_EMU_H
+#define CLASSSIMZ80_EMU_H
+
+#include "AppTypes.h"
+#include "z80state.h"
+
+/*
+ * ClassSimZ80_Emu is an instruction-level Z80 emulator
+ * It executes whole instructions on the simulated RAM and IO space of the trickbox, with the documented and the
+ * undocumented flags and the T-state count of every instruction. It is used to fast-forward a program to a point
+ * of interest, from which the netlist simulation continues (see ClassSimZ80_AVX2::fastForward()).
+ * It does not model the interrupt, wait or bus request pins, nor the trickbox pin controls.
+ */
+class ClassSimZ80_Emu
+{
+public:
+    void reset();                           // Sets the registers to their values after a chip reset
+    uint step();                            // Executes one instruction, returns the number of T-states it took
+    quint64 run(quint64 maxTstates, int stopPc); // Runs until the T-state count or the PC address (if not -1)
+    void readState(z80state &z);            // Reads the registers into a state structure
+    void setState(const z80state &z);       // Sets the registers from a state structure
+
+    uint8_t a, f, b, c, d, e, h, l;         // General purpose registers
+    uint8_t a2, f2, b2, c2, d2, e2, h2, l2; // Alternate set of general purpose registers
+    uint16_t ix, iy, sp, pc, wz;            // Indexing and system registers; WZ is the internal MEMPTR
+    uint8_t i, r;                           // Interrupt vector and memory refresh registers
+    bool iff1, iff2;                        // Interrupt enable flip-flops
+    uint8_t im;                             // Interrupt mode
+    bool halted;                            // Stopped at (or executing) a HALT instruction
+    bool stopped;                           // The program asked the trickbox to stop the simulation
+    quint64 tstates;                        // T-states since the reset
+
+private:
+    uint8_t fetch();                        // Reads an opcode (M1 cycle, increments R)
+    uint8_t imm8() { return rd(pc++); }
+    uint16_t imm16() { uint16_t v = rd(pc++); return v | (rd(pc++) << 8); }
+    uint8_t rd(uint16_t addr);
+    void wr(uint16_t addr, uint8_t v);
+    uint8_t in(uint16_t addr);
+    void out(uint16_t addr, uint8_t v);
+    void push(uint16_t v) { wr(--sp, v >> 8); wr(--sp, v & 0xFF); }
+    uint16_t pop() { uint16_t v = rd(sp++); return v | (rd(sp++) << 8); }
+    void setF(uint8_t v) { f = v; m_flagsSet = true; }
+
+    uint16_t getRP(uint p);                 // Register pairs BC, DE, HL (or the index register), SP
+    void setRP(uint p, uint16_t v);
+    uint16_t getRP2(uint p) { return (p == 3) ? uint16_t((a << 8) | f) : getRP(p); } // AF instead of SP
+    void setRP2(uint p, uint16_t v);
+    uint8_t getR(uint n);                   // Registers B, C, D, E, H, L, (HL), A; H and L may be the index halves
+    void setR(uint n, uint8_t v);
+    uint16_t getHL() { return m_idx == 1 ? ix : m_idx == 2 ? iy : uint16_t((h << 8) | l); }
+    void setHL(uint16_t v);
+    uint16_t addrHL();                      // Address of the (HL) operand; (IX+d) or (IY+d) with a prefix
+    bool cond(uint cc);
+
+    void alu(uint op, uint8_t v);           // ADD, ADC, SUB, SBC, AND, XOR, OR, CP
+    uint8_t inc8(uint8_t v);
+    uint8_t dec8(uint8_t v);
+    uint16_t add16(uint16_t x, uint16_t y);
+    void adc16(uint16_t v);
+    void sbc16(uint16_t v);
+    uint8_t rot(uint op, uint8_t v);        // RLC, RRC, RL, RR, SLA, SRA, SLL, SRL
+    void daa();
+
+    void exec(uint8_t op);                  // Unprefixed opcodes, and those with the DD and FD prefix
+    void execCB();
+    void execED();
+    void execIndexCB();
+    void blockLD(int dir, bool repeat);     // Block instructions: dir is +1 for the incrementing ones, -1 otherwise
+    void blockCP(int dir, bool repeat);
+    void blockIN(int dir, bool repeat);
+    void blockOUT(int dir, bool repeat);
+    void blockRepeat();                     // Repeats a block instruction
+    void blockIORepeat(uint8_t v);
+
+    uint m_t {};                            // T-states of the current instruction
+    uint m_idx {};                          // Index prefix of the current instruction: 0 none, 1 IX, 2 IY
+    uint16_t m_addr {};                     // Address of the (IX+d) operand, once its displacement is read
+    bool m_addrValid {};
+    bool m_flagsSet {};                     // The current instruction has set the flags
+    uint8_t m_q {};                         // Flags set by the previous instruction, or zero (for SCF and CCF)
+};
+
+#endif // CLASSSIMZ80_EMU_H
@@ -4,10 +4,6 @@
 #include <QFile>
 #include <QFileInfo>
 
-#define TRICKBOX_START    0xD000
-#define TRICKBOX_END      (TRICKBOX_START + sizeof(trick) - 1)
-#define TRICKBOX_PIN_HOLD 20
-
 const static QStringList pins = { "int", "nmi", "busrq", "wait", "reset" };
 
 ClassTrickbox::ClassTrickbox(QObject *parent) : QObject(parent)
@@ -26,6 +22,44 @@ void ClassTrickbox::reset()
         m_trick->pinCtrl[i].hold = TRICKBOX_PIN_HOLD;
 }
 
+/*
+ * Returns the simulated RAM, IO space and the trickbox state (its control area is a part of the RAM), compressed
+ * The simulator takes it with each of its checkpoints; most of the RAM and IO space compresses to nothing
+ */
+QByteArray ClassTrickbox::saveState()
+{
+    QByteArray state;
+    state.reserve(sizeof(m_mem) + sizeof(m_mio) + 4);
+    state.append(reinterpret_cast<const char *>(m_mem), sizeof(m_mem));
+    state.append(reinterpret_cast<const char *>(m_mio), sizeof(m_mio));
+    state.append(char(m_trickWriteEven));
+    state.append(char(m_bpnet & 0xFF)).append(char(m_bpnet >> 8));
+    state.append(char(m_bpval));
+    return qCompress(state, 1);
+}
+
+/*
+ * Restores the state that saveState() returned
+ */
+void ClassTrickbox::restoreState(const QByteArray &state)
+{
+    const QByteArray s = qUncompress(state);
+    if (s.size() != sizeof(m_mem) + sizeof(m_mio) + 4)
+    {
+        qWarning() << "Invalid trickbox state";
+        return;
+    }
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(s.constData());
+    m_writes.fetchAndAddRelaxed(1);
+    memcpy(m_mem, p, sizeof(m_mem));
+    memcpy(m_mio, p + sizeof(m_mem), sizeof(m_mio));
+    p += sizeof(m_mem) + sizeof(m_mio);
+    m_trickWriteEven = p[0];
+    m_bpnet = p[1] | (p[2] << 8);
+    m_bpval = p[3];
+    emit refresh();
+}
+
 /*
  * Reads from simulated RAM
  */
@@ -39,6 +73,7 @@ quint8 ClassTrickbox::readMem(quint16 ab)
  */
 void ClassTrickbox::writeMem(quint16 ab, quint8 db)
 {
+    m_writes.fetchAndAddRelaxed(1);
     if (ab >= m_rom)
         m_mem[ab] = db;
 
@@ -103,6 +138,7 @@ void ClassTrickbox::writeIO(quint16 ab, quint8 db)
     if ((ab & 0xFE) == 0x80) // 1-byte IO addresses: 0x80 and 0x81
         ab &= 0xFF;
     m_mio[ab] = db;
+    m_writes.fetchAndAddRelaxed(1);
     // IO address 0x81 holds the value to be shown on the bus during interrupt - see ClassSimZ80::handleIrq()
     // IO address 0x80 is a character out address
     if (m_trickEnabled && (ab == 0x80))
@@ -177,6 +213,7 @@ void ClassTrickbox::onTick(uint ticks)
     bool anyPC = m_trick->pinCtrl[0].atPC | m_trick->pinCtrl[1].atPC | m_trick->pinCtrl[2].atPC | m_trick->pinCtrl[3].atPC | m_trick->pinCtrl[4].atPC;
     uint16_t pc = anyPC ? ::controller.getSimZ80().getPC() : 0;
 
+    uint mask = 0, values = 0; // Pins that change on this tick, set together
     for (uint i = 0; i < MAX_PIN_CTRL; i++) // { "_int", "_nmi", "_busrq", "_wait", "_reset" };
     {
         if (pc && (pc == m_trick->pinCtrl[i].atPC))
@@ -188,7 +225,7 @@ void ClassTrickbox::onTick(uint ticks)
         if ((m_trick->pinCtrl[i].atCycle == 0) || (m_trick->pinCtrl[i].atCycle > ticks))
             continue;
         if (m_trick->pinCtrl[i].atCycle == ticks)
-            ::controller.getSimZ80().setPin(i, 0); // and assert its pin if the cycle is reached
+            mask |= 1u << i; // and assert its pin if the cycle is reached
         else
         {
             // hold == 0 means "hold indefinitely", skip decrement and release.
@@ -198,13 +235,39 @@ void ClassTrickbox::onTick(uint ticks)
                 m_trick->pinCtrl[i].hold--;
                 if (m_trick->pinCtrl[i].hold == 0)
                 {
-                    ::controller.getSimZ80().setPin(i, 1); // Release the pin
+                    mask |= 1u << i; // Release the pin
+                    values |= 1u << i;
                     m_trick->pinCtrl[i].atCycle = 0; // Disarm the trigger
                     m_trick->pinCtrl[i].hold = TRICKBOX_PIN_HOLD; // Reset hold to its default
                 }
             }
         }
     }
+    if (mask)
+        ::controller.getSimZ80().setPins(mask, values);
+}
+
+/*
+ * Returns the half-clock tick, from the given one on, of the next stop or pin event that onTick() has scheduled, or
+ * UINT_MAX if there is none. A pin that is being held counts down on every tick, so it returns the given tick itself.
+ * A break on a net value and a pin assert at a PC address are not scheduled: they depend on the chip state.
+ */
+uint ClassTrickbox::nextEvent(uint ticks)
+{
+    uint next = UINT_MAX;
+    if (!m_trickEnabled)
+        return next;
+    if (m_trick->cycleStop && (m_trick->cycleStop >= ticks))
+        next = m_trick->cycleStop;
+    for (uint i = 0; i < MAX_PIN_CTRL; i++)
+    {
+        const uint at = m_trick->pinCtrl[i].atCycle;
+        if (at && (at >= ticks))
+            next = qMin(next, at);
+        else if (at && m_trick->pinCtrl[i].hold) // Held for a number of ticks; zero holds indefinitely
+            return ticks;
+    }
+    return next;
 }
 
 /*
@@ -243,6 +306,37 @@ void ClassTrickbox::set(QString pin, quint8 value)
         qWarning() << "Invalid pin name. Only input pads can be set:" << pins;
 }
 
+/*
+ * Sets named pins to values (0,1,2) together, given as an object of pin names and values, such as {int:0, wait:0}
+ * The chip settles once, with all of them applied
+ */
+void ClassTrickbox::setPins(QVariantMap values)
+{
+    uint mask = 0, bits = 0;
+    for (auto it = values.constBegin(); it != values.constEnd(); it++)
+    {
+        const int i = pins.indexOf(it.key());
+        const uint value = it.value().toUInt();
+        if (i < 0)
+        {
+            qWarning() << "Invalid pin name. Only input pads can be set:" << pins;
+            return;
+        }
+        if (value > 2)
+        {
+            qWarning() << "Invalid value. Permitted values are 0, 1 and 2";
+            return;
+        }
+        mask |= 1u << i;
+        bits |= uint(value != 0) << i;
+    }
+    if (mask)
+    {
+        ::controller.getSimZ80().setPins(mask, bits);
+        emit refresh();
+    }
+}
+
 /*
  * Activates (sets to 0) a named pin at the specified hcycle and holds it for the "hold" number of cycles
  * If the hold value is 0, it holds indefinitely.
@@ -308,6 +402,7 @@ bool ClassTrickbox::loadHex(const QString fileName, bool clearMem)
         qInfo() << "Clearing simulator RAM and setting IO space to FF";
     }
 
+    m_writes.fetchAndAddRelaxed(1);
     QTextStream in(&file);
     while (!in.atEnd())
     {
@@ -372,6 +467,7 @@ bool ClassTrickbox::loadBin(const QString fileName, quint16 address)
     }
 
     QByteArray blob = file.readAll();
+    m_writes.fetchAndAddRelaxed(1);
     uint p = address;
     for (int i = 0; (i < blob.length()) && (p < 0x10000); i++, p++)
         m_mem[p] = blob[i];
@@ -403,6 +499,19 @@ bool ClassTrickbox::saveBin(const QString fileName, quint16 address, uint size)
     return true;
 }
 
+#if HEADLESS_CLI // The command-line runner has no windows
+
+void ClassTrickbox::zx()
+{
+    qWarning() << "zx() is not available in the command-line runner";
+}
+
+void ClassTrickbox::onShutdown()
+{
+}
+
+#else // HEADLESS_CLI
+
 #include <QWidget>
 
 struct zx : public QWidget
@@ -454,3 +563,5 @@ void ClassTrickbox::onShutdown()
     if (m_zx)
         m_zx->close();
 }
+
+#endif // HEADLESS_CLI
@@ -1,7 +1,9 @@
 #ifndef CLASSTRICKBOX_H
 #define CLASSTRICKBOX_H
 
+#include <QAtomicInteger>
 #include <QObject>
+#include <QVariantMap>
 
 // Defines the layout of the trickbox control area
 #pragma pack(push,2)
@@ -20,6 +22,10 @@ struct trick
 };
 #pragma pack(pop)
 
+#define TRICKBOX_START    0xD000
+#define TRICKBOX_END      (TRICKBOX_START + sizeof(trick) - 1)
+#define TRICKBOX_PIN_HOLD 20
+
 struct zx;
 
 /*
@@ -33,6 +39,13 @@ public:
 
     void reset();                           // Reset the control counters etc.
     void onTick(uint ticks);                // Called by the simulator on every half-clock tick
+    uint nextEvent(uint ticks);             // Returns the half-clock tick of the next scheduled stop or pin event
+    const uint8_t *getMem() { return m_mem; } // Returns the simulated RAM (64K)
+    const uint8_t *getIO() { return m_mio; }  // Returns the simulated IO space (64K)
+    uint getRom() { return m_rom; }           // Returns the size of the read-only initial memory block
+    uint getWrites() { return m_writes; }     // Returns the count of writes to the RAM and IO space, from any thread
+    QByteArray saveState();                 // Returns the RAM, IO space and trickbox state, compressed (checkpoints)
+    void restoreState(const QByteArray &state); // Restores the state that saveState() returned
     Q_PROPERTY(bool enabled MEMBER m_trickEnabled) //* Enables or disables trickbox control
     Q_PROPERTY(uint rom MEMBER m_rom)       //* Designates the initial memory block as read-only
 
@@ -53,6 +66,7 @@ public slots:
         { m_trick->cycleStop = hcycle; emit refresh(); }
     void breakWhen(quint16 net, quint8 value); //* Stops running when the given net number's state equals the value
     void set(QString pin, quint8 value);    //* Sets named pin to a value (0,1,2)
+    void setPins(QVariantMap values);       //* Sets named pins to values (0,1,2) together, settling the chip once
     void setAt(QString pin, quint16 hcycle, quint16 hold); //* Activates (sets to 0) a named pin at the specified hcycle
     void setAtPC(QString pin, quint16 addr, quint16 hold); //* Activates (sets to 0) a named pin when PC equals the address
 
@@ -71,6 +85,7 @@ private:
     bool m_trickWriteEven {true};           // Even/odd write address to the control area
     bool m_trickEnabled {true};             // Trickbox control is enabled
     uint m_rom {0};                         // Designates the initial memory block as read-only
+    QAtomicInteger<uint> m_writes {};       // Writes to the RAM and IO space by the simulation, scripts and GUI
     QString m_lastLoadedHex;                // File name of the last loaded hex code
     quint16 m_bpnet {};                     // Net number to check for break
     quint8 m_bpval {};                      // Value to break at
@@ -12,6 +12,8 @@ DockMonitor::DockMonitor(QWidget *parent) :
 {
     ui->setupUi(this);
     setAcceptDrops(true);
+    // The performance counters panel is shown only when the simulator counts them
+    ui->textPerf->setVisible(USE_AVX2_SIM && SIM_PERF_COUNTERS);
 
     connect(&::controller.getTrickbox(), SIGNAL(echo(char)), this, SLOT(onEcho(char)));
     connect(&::controller.getTrickbox(), SIGNAL(echo(QString)), this, SLOT(onEcho(QString)));
@@ -75,6 +77,9 @@ void DockMonitor::refresh()
     ::controller.readState(z80);
     const QString monitor = ::controller.getTrickbox().readState();
     ui->textStatus->setPlainText(z80state::dumpState(z80) % monitor);
+#if USE_AVX2_SIM && SIM_PERF_COUNTERS
+    ui->textPerf->setPlainText(::controller.getSimZ80().getPerfCounters().toString());
+#endif
 }
 
 /*
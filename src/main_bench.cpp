@@ -0,0 +1,217 @@
+#include "ClassController.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QSettings>
+#include <algorithm>
+#include <stdio.h>
+
+// Global objects
+ClassController controller {}; // Application-wide controller class
+
+/*
+ * Simulation throughput benchmark: runs fixed workloads (hex files) on the simulation engines, each for a fixed
+ * number of half-cycles, or until the trickbox stops it, and several times over. Prints a table and writes the
+ * results as JSON: the median and the best wall time, half-cycles per second and the nets evaluated per half-cycle.
+ * With --kernels, it also records the inputs of each workload on the optimized simulator and replays them, timing
+ * the individual simulation kernels with every instruction set level that this CPU supports.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setOrganizationDomain("BaltazarStudios.com");
+    QCoreApplication::setOrganizationName("Baltazar Studios, LLC");
+    QCoreApplication::setApplicationName("Z80Explorer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the throughput of the Z80Explorer netlist simulators");
+    parser.addHelpOption();
+    parser.addPositionalArgument("hex", "Workloads; by default, hello_world.hex, zexall.hex and the assembled tests/*.hex", "[hex...]");
+    QCommandLineOption cyclesOption({"n", "hcycles"}, "Number of half-cycles to run each workload (default 20000)", "count", "20000");
+    QCommandLineOption repeatOption({"k", "repeat"}, "Number of runs of each workload (default 3)", "count", "3");
+    QCommandLineOption resourceOption({"r", "resource"}, "Chip resource folder; by default, the one the application uses", "dir");
+    QCommandLineOption engineOption({"e", "engine"}, "Simulators to run: optimized, reference or both (default)", "engine", "both");
+    QCommandLineOption jsonOption({"o", "json"}, "File to write the results to (default bench.json)", "file", "bench.json");
+    QCommandLineOption quietOption({"q", "quiet"}, "Does not print the log messages");
+    QCommandLineOption kernelsOption({"m", "kernels"}, "Also times the simulation kernels replaying the recorded workloads (micro-benchmarks)");
+    QCommandLineOption traceOption({"t", "traces"}, "Folder to save the recorded workload traces to, as <workload>.trace", "dir");
+    parser.addOptions({ cyclesOption, repeatOption, resourceOption, engineOption, jsonOption, quietOption, kernelsOption, traceOption });
+    parser.process(a);
+
+    bool ok1, ok2;
+    const uint hcycles = parser.value(cyclesOption).toUInt(&ok1);
+    const uint repeat = parser.value(repeatOption).toUInt(&ok2);
+    if (!ok1 || !hcycles || (hcycles > INT_MAX) || !ok2 || !repeat)
+    {
+        fprintf(stderr, "Invalid number of half-cycles or runs\n");
+        return 1;
+    }
+    QList<SimEngine> engines;
+    const QString engineName = parser.value(engineOption);
+    if ((engineName == "optimized") || (engineName == "both"))
+        engines.append(SimEngine::Optimized);
+    if ((engineName == "reference") || (engineName == "both"))
+        engines.append(SimEngine::Reference);
+    if (engines.isEmpty())
+    {
+        fprintf(stderr, "Unknown simulator: %s\n", qPrintable(engineName));
+        return 1;
+    }
+    if (parser.isSet(quietOption))
+        QLoggingCategory::setFilterRules("*.debug=false\n*.info=false");
+
+    QSettings settings;
+    QString resDir = settings.value("ResourceDir", QDir::currentPath() + "/resource").toString();
+    if (parser.isSet(resourceOption))
+        resDir = QFileInfo(parser.value(resourceOption)).absoluteFilePath();
+    const QString jsonFile = QFileInfo(parser.value(jsonOption)).absoluteFilePath();
+    const QString traceDir = parser.isSet(traceOption) ? QFileInfo(parser.value(traceOption)).absoluteFilePath() : QString();
+#if USE_AVX2_SIM
+    const bool kernels = parser.isSet(kernelsOption) || parser.isSet(traceOption);
+#else
+    const bool kernels = false;
+    if (parser.isSet(kernelsOption) || parser.isSet(traceOption))
+        qWarning() << "Kernel micro-benchmarks need the optimized simulator";
+#endif
+
+    // The paths are resolved before the controller makes the resource folder current
+    QStringList workloads;
+    for (const QString &name : parser.positionalArguments())
+        workloads.append(QFileInfo(name).absoluteFilePath());
+    if (workloads.isEmpty())
+    {
+        workloads << resDir + "/hello_world.hex" << resDir + "/zexall.hex";
+        // The tests are assembled into hex files next to their sources by tests/make_test.bat
+        for (const QString &name : QDir(resDir + "/tests").entryList({ "*.hex" }, QDir::Files, QDir::Name))
+            workloads.append(resDir + "/tests/" + name);
+    }
+
+    // The kernels are replayed on the optimized simulator, even if only the reference one is benchmarked
+    QList<SimEngine> loaded = engines;
+    if (kernels && !loaded.contains(SimEngine::Optimized))
+        loaded.append(SimEngine::Optimized);
+    if (!::controller.init(resDir, loaded))
+        return 1;
+
+    printf("%-24s %-10s %10s %10s %10s %12s %10s\n", "workload", "engine", "hcycles", "median s", "best s", "hcycles/s", "nets/hc");
+    QJsonArray results;
+    for (const QString &workload : workloads)
+    {
+        for (SimEngine engine : engines)
+        {
+            ::controller.getSimZ80().setEngine(engine);
+            QVector<qint64> ns;
+            uint ran = 0;
+            quint64 nets = 0;
+            for (uint i = 0; i < repeat; i++)
+            {
+                if (!::controller.loadHex(workload))
+                    return 1;
+                ::controller.doReset();
+                const quint64 nets0 = ::controller.getSimZ80().getNetsRecalculated();
+                QElapsedTimer elapsed;
+                elapsed.start();
+                ran = ::controller.runsim(hcycles);
+                ns.append(qMax(elapsed.nsecsElapsed(), qint64(1)));
+                nets = ::controller.getSimZ80().getNetsRecalculated() - nets0;
+            }
+            std::sort(ns.begin(), ns.end());
+            const double median = ns[ns.count() / 2] / 1e9, best = ns.first() / 1e9;
+            const double perHcycle = ran ? double(nets) / ran : 0;
+            const QString name = QFileInfo(workload).fileName();
+            printf("%-24s %-10s %10u %10.3f %10.3f %12.0f %10.1f\n", qPrintable(name), ClassSimCli::engineName(engine),
+                   ran, median, best, ran / median, perHcycle);
+            fflush(stdout);
+
+            QJsonObject result;
+            result["workload"] = name;
+            result["engine"] = ClassSimCli::engineName(engine);
+            result["hcycles"] = int(ran);
+            result["runs"] = int(repeat);
+            result["wall_s_median"] = median;
+            result["wall_s_best"] = best;
+            result["hcycles_per_s"] = ran / median;
+            result["nets_per_hcycle"] = perHcycle;
+            results.append(result);
+        }
+    }
+
+    // Kernel micro-benchmarks replay the same recorded inputs with each kernel and instruction set level
+    QJsonArray kernelResults;
+#if USE_AVX2_SIM
+    if (kernels)
+    {
+        ClassSimZ80_AVX2 &sim = ::controller.getSimZ80().m_optimized;
+        const SimIsa isa = sim.getIsa();
+        printf("\n%-24s %-14s %-8s %10s %12s %10s %6s\n", "workload", "kernel", "isa", "ns/call", "calls", "waves", "exact");
+        for (const QString &workload : workloads)
+        {
+            ::controller.getSimZ80().setEngine(SimEngine::Optimized);
+            if (!::controller.loadHex(workload))
+                return 1;
+            ::controller.doReset();
+            sim.startRecording();
+            ::controller.runsim(hcycles);
+            const SimTrace trace = sim.stopRecording();
+            const QString name = QFileInfo(workload).fileName();
+            if (!traceDir.isEmpty())
+                trace.save(traceDir + "/" + QFileInfo(workload).completeBaseName() + ".trace");
+
+            for (SimKernel kernel : { SimKernel::RecalcNetlist, SimKernel::RecalcNet, SimKernel::GroupSearch, SimKernel::NetValue })
+            {
+                for (int i = int(SimIsa::Scalar); i <= int(ClassSimZ80_AVX2::detectIsa()); i++)
+                {
+                    sim.setIsa(SimIsa(i));
+                    const SimKernelStats stats = sim.replay(trace, kernel);
+                    const double ns = stats.calls ? double(stats.ns) / stats.calls : 0;
+                    printf("%-24s %-14s %-8s %10.1f %12llu %10llu %6s\n", qPrintable(name), ClassSimZ80_AVX2::kernelName(kernel),
+                           ClassSimZ80_AVX2::isaName(SimIsa(i)), ns, stats.calls, stats.waves, stats.exact ? "yes" : "NO");
+                    fflush(stdout);
+
+                    QJsonObject result;
+                    result["workload"] = name;
+                    result["kernel"] = ClassSimZ80_AVX2::kernelName(kernel);
+                    result["isa"] = ClassSimZ80_AVX2::isaName(SimIsa(i));
+                    result["ns_per_call"] = ns;
+                    result["calls"] = double(stats.calls);
+                    result["waves"] = double(stats.waves);
+                    result["exact"] = stats.exact;
+                    kernelResults.append(result);
+                }
+            }
+            sim.setIsa(isa);
+        }
+    }
+#endif
+
+    QJsonObject json;
+    json["version"] = APP_VERSION;
+    json["hcycles"] = int(hcycles);
+    json["compiled_netlist"] = bool(USE_COMPILED_SIM);
+#if USE_AVX2_SIM
+    json["isa"] = ClassSimZ80_AVX2::isaName(::controller.getSimZ80().m_optimized.getIsa());
+    json["threads"] = int(::controller.getSimZ80().m_optimized.getThreads());
+#endif
+    json["results"] = results;
+    if (kernels)
+        json["kernels"] = kernelResults;
+    QFile file(jsonFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        qCritical() << "Unable to write" << jsonFile;
+        return 1;
+    }
+    file.write(QJsonDocument(json).toJson());
+    qInfo() << "Saved the results to" << jsonFile;
+
+    emit ::controller.shutdown();
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "ClassController.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QSettings>
+#include <stdio.h>
+
+// Global objects
+ClassController controller {}; // Application-wide controller class
+
+/*
+ * Command-line runner: loads a hex file, resets the chip and runs it for a number of half-cycles, or until the
+ * trickbox stops the simulation, without any windows. Prints the console output, the chip state and the achieved
+ * speed, and exits with a zero status code if the program ran, or with a non-zero one if it could not be loaded.
+ * Instead of the reset, it can start from a saved simulation state (for example, a booted system), into which the
+ * hex file, if any, is merged; it can also save the state when the run stops. It can also fast-forward the program on
+ * the instruction-level emulator to a half-cycle or a PC address, and run on the netlist from there.
+ * For the validation, it can run the reference simulator in lockstep with the optimized one, comparing their net and
+ * transistor states; it exits with a non-zero status code if they diverge.
+ * A training run saves the nets that did not change into a constant nets file, and a later run can load that file to
+ * simulate a netlist reduced by those constants. The observed constants are folded only on request, and a run that
+ * changes one of them stops, exiting with a non-zero status code.
+ * It can also export the chip model as a Verilog module and as a standalone C model, without running anything.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setOrganizationDomain("BaltazarStudios.com");
+    QCoreApplication::setOrganizationName("Baltazar Studios, LLC");
+    QCoreApplication::setApplicationName("Z80Explorer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a Z80 program on the Z80Explorer netlist simulator, without the GUI");
+    parser.addHelpOption();
+    parser.addPositionalArgument("hex", "Intel HEX file to load into the simulated RAM; optional with --state", "[hex]");
+    QCommandLineOption cyclesOption({"n", "hcycles"}, "Number of half-cycles to run; by default, runs until the trickbox stops", "count");
+    QCommandLineOption resourceOption({"r", "resource"}, "Chip resource folder; by default, the one the application uses", "dir");
+    QCommandLineOption engineOption({"e", "engine"}, "Simulator to run: optimized (default) or reference", "engine", "optimized");
+    QCommandLineOption quietOption({"q", "quiet"}, "Does not print the log messages");
+    QCommandLineOption stateOption({"s", "state"}, "Starts from a saved simulation state instead of the reset; the hex file is merged into its RAM", "file");
+    QCommandLineOption saveStateOption("save-state", "Saves the simulation state into a file when the run stops", "file");
+    QCommandLineOption ffOption({"f", "fast-forward"}, "Emulates the program from the reset up to the half-cycle, then runs it on the netlist", "hcycle");
+    QCommandLineOption ffPcOption("fast-forward-pc", "Emulates the program from the reset until the PC reaches the (hex) address, then runs it on the netlist", "address");
+    QCommandLineOption lockstepOption("lockstep", "Runs the reference simulator in lockstep with the optimized one, comparing all nets every N half-cycles", "N");
+    QCommandLineOption constantsOption({"c", "constants"}, "Reduces the netlist by the constant nets from a file before the run", "file");
+    QCommandLineOption observedOption("constants-observed", "Also folds the constant nets observed in the training run; a run that changes one stops with an error");
+    QCommandLineOption trainOption("train-constants", "Saves the constant nets, proven and observed in this run, into a file", "file");
+    QCommandLineOption verilogOption("export-verilog", "Exports the chip model as a gate-level Verilog module and exits", "file");
+    QCommandLineOption cModelOption("export-c", "Exports the chip model as a standalone C model and exits", "file");
+    parser.addOptions({ cyclesOption, resourceOption, engineOption, quietOption, stateOption, saveStateOption, ffOption, ffPcOption, lockstepOption,
+                        constantsOption, observedOption, trainOption, verilogOption, cModelOption });
+    parser.process(a);
+
+    const bool exporting = parser.isSet(verilogOption) || parser.isSet(cModelOption);
+    if ((parser.positionalArguments().count() > 1) || (parser.positionalArguments().isEmpty() && !parser.isSet(stateOption) && !exporting))
+        parser.showHelp(1);
+    const QString hexFile = parser.positionalArguments().isEmpty() ? QString() : QFileInfo(parser.positionalArguments().first()).absoluteFilePath();
+    const QString stateFile = parser.isSet(stateOption) ? QFileInfo(parser.value(stateOption)).absoluteFilePath() : QString();
+    const QString saveStateFile = parser.isSet(saveStateOption) ? QFileInfo(parser.value(saveStateOption)).absoluteFilePath() : QString();
+    const QString constantsFile = parser.isSet(constantsOption) ? QFileInfo(parser.value(constantsOption)).absoluteFilePath() : QString();
+    const QString trainFile = parser.isSet(trainOption) ? QFileInfo(parser.value(trainOption)).absoluteFilePath() : QString();
+    uint hcycles = INT_MAX;
+    if (parser.isSet(cyclesOption))
+    {
+        bool ok;
+        hcycles = parser.value(cyclesOption).toUInt(&ok);
+        if (!ok || !hcycles || (hcycles > INT_MAX))
+        {
+            fprintf(stderr, "Invalid number of half-cycles: %s\n", qPrintable(parser.value(cyclesOption)));
+            return 1;
+        }
+    }
+    const bool fastForward = parser.isSet(ffOption) || parser.isSet(ffPcOption);
+    uint ffHcycles = INT_MAX;
+    int ffPc = -1;
+    if (parser.isSet(ffOption))
+    {
+        bool ok;
+        ffHcycles = parser.value(ffOption).toUInt(&ok);
+        if (!ok || (ffHcycles > INT_MAX))
+        {
+            fprintf(stderr, "Invalid fast-forward half-cycle: %s\n", qPrintable(parser.value(ffOption)));
+            return 1;
+        }
+    }
+    if (parser.isSet(ffPcOption))
+    {
+        bool ok;
+        const uint addr = parser.value(ffPcOption).toUInt(&ok, 16);
+        if (!ok || (addr > 0xFFFF))
+        {
+            fprintf(stderr, "Invalid fast-forward address: %s\n", qPrintable(parser.value(ffPcOption)));
+            return 1;
+        }
+        ffPc = int(addr);
+    }
+    uint lockstepEvery = 0;
+    if (parser.isSet(lockstepOption))
+    {
+        bool ok;
+        lockstepEvery = parser.value(lockstepOption).toUInt(&ok);
+        if (!ok || !lockstepEvery)
+        {
+            fprintf(stderr, "Invalid lockstep comparison interval: %s\n", qPrintable(parser.value(lockstepOption)));
+            return 1;
+        }
+    }
+    if (fastForward && !stateFile.isEmpty())
+    {
+        fprintf(stderr, "Fast-forward starts from the reset; it cannot start from a state file\n");
+        return 1;
+    }
+    SimEngine engine;
+    if (parser.value(engineOption) == "optimized")
+        engine = SimEngine::Optimized;
+    else if (parser.value(engineOption) == "reference")
+        engine = SimEngine::Reference;
+    else
+    {
+        fprintf(stderr, "Unknown simulator: %s\n", qPrintable(parser.value(engineOption)));
+        return 1;
+    }
+    if ((!stateFile.isEmpty() || !saveStateFile.isEmpty() || fastForward || lockstepEvery || !constantsFile.isEmpty() || !trainFile.isEmpty()) &&
+        (engine != SimEngine::Optimized))
+    {
+        fprintf(stderr, "Simulation state files, fast-forward, lockstep and constant nets need the optimized simulator\n");
+        return 1;
+    }
+    if (parser.isSet(quietOption))
+        QLoggingCategory::setFilterRules("*.debug=false\n*.info=false");
+
+    QSettings settings;
+    QString resDir = settings.value("ResourceDir", QDir::currentPath() + "/resource").toString();
+    if (parser.isSet(resourceOption))
+        resDir = QFileInfo(parser.value(resourceOption)).absoluteFilePath();
+
+    QList<SimEngine> engines { engine };
+    // The reference simulator follows the optimized one in lockstep, and its netlist is the one that is exported
+    if ((lockstepEvery || exporting) && !engines.contains(SimEngine::Reference))
+        engines.append(SimEngine::Reference);
+    if (!::controller.init(resDir, engines))
+        return 1;
+    if (exporting)
+    {
+        if (parser.isSet(verilogOption) && !::controller.getNetlist().exportVerilog(QFileInfo(parser.value(verilogOption)).absoluteFilePath()))
+            return 1;
+        if (parser.isSet(cModelOption) && !::controller.getNetlist().exportC(QFileInfo(parser.value(cModelOption)).absoluteFilePath()))
+            return 1;
+        emit ::controller.shutdown();
+        return 0;
+    }
+    if (stateFile.isEmpty() && !::controller.loadHex(hexFile))
+        return 1;
+    if (!constantsFile.isEmpty() && !::controller.getSimZ80().loadConstants(constantsFile, parser.isSet(observedOption)))
+        return 1;
+
+    // Console output of the simulated program goes to stdout
+    QObject::connect(&::controller.getTrickbox(), QOverload<char>::of(&ClassTrickbox::echo), [](char c) { putchar(c); });
+    QObject::connect(&::controller.getTrickbox(), QOverload<QString>::of(&ClassTrickbox::echo), [](QString s) { fputs(qPrintable(s), stdout); });
+
+    if (!trainFile.isEmpty()) // The constant nets must hold through the reset, which runs on the reduced netlist too
+        ::controller.getSimZ80().startTraining();
+    if (fastForward)
+        ::controller.doFastForward(ffHcycles, ffPc);
+    else if (stateFile.isEmpty())
+        ::controller.doReset();
+    else if (!::controller.getSimZ80().loadState(stateFile) || (!hexFile.isEmpty() && !::controller.getTrickbox().patchHex(hexFile)))
+        return 1;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const uint start = ::controller.getSimZ80().getCurrentHCycle();
+    const bool matched = !lockstepEvery || ::controller.doLockstep(hcycles, lockstepEvery);
+    const uint ran = lockstepEvery ? ::controller.getSimZ80().getCurrentHCycle() - start : ::controller.runsim(hcycles);
+    const qint64 ms = qMax(elapsed.elapsed(), qint64(1));
+    const bool folded = ::controller.getSimZ80().getFoldedChange() != 0;
+
+    z80state z;
+    ::controller.readState(z);
+    printf("\n%s", qPrintable(z80state::dumpState(z)));
+    printf("Ran %u half-cycles in %.3f s (%u Hz)%s\n", ran, ms / 1000.0, uint(ran / 2.0 / (ms / 1000.0)),
+           folded ? ", stopped where a folded constant net changed" : (ran >= hcycles) ? "" :
+           matched ? ", stopped by the trickbox" : ", stopped where the simulators diverged");
+    fflush(stdout);
+    if (!matched || folded || (!saveStateFile.isEmpty() && !::controller.getSimZ80().saveState(saveStateFile)))
+        return 1;
+    if (!trainFile.isEmpty() && !::controller.getSimZ80().saveConstants(trainFile))
+        return 1;
+
+    emit ::controller.shutdown();
+    return 0;
+}
@@ -0,0 +1,313 @@
+/*
+ * NetlistCompiler reads the Z80 netlist resources (transdefs.js, segdefs.js and nodenames.js) and writes C++ source
+ * of ClassSimZ80_Compiled with the netlist topology baked in: straight-line group search functions for the nets of
+ * every multi-net component, with all transistor and net numbers as constants, and constant adjacency tables.
+ *
+ * Usage: NetlistCompiler <resource directory> <output file>
+ *
+ * The netlist is read exactly the way ClassSimZ80_AVX2 loads it, so the generated code visits the nets in the same
+ * order and the compiled simulator stays bit-identical to it. This tool is built and run by CMake (option
+ * Z80_COMPILED_SIM) and uses only the standard library, so it does not depend on Qt.
+ */
+#include "AppTypes.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Edge { tran_t t; net_t other; };
+
+static std::vector<net_t> transGate, transC1, transC2;
+static std::vector<std::vector<tran_t>> gates;  // Transistors gated by each net, in the order of transdefs.js
+static std::vector<std::vector<Edge>> edges;    // Adjacency of each net, in the order of transdefs.js
+static std::vector<bool> pullup;
+static std::vector<uint32_t> ccc;               // Channel-connected component of each net
+static std::map<uint32_t, uint64_t> cccWords;   // Group bitset words used by each component
+static std::map<uint32_t, unsigned> cccSize;    // Number of nets in each component
+static std::map<net_t, std::string> names;
+static net_t npwr = 2;
+
+static std::string trim(const std::string &s)
+{
+    size_t a = s.find_first_not_of(" \t\r'\"");
+    size_t b = s.find_last_not_of(" \t\r'\"");
+    return (a == std::string::npos) ? std::string() : s.substr(a, b - a + 1);
+}
+
+static std::vector<std::string> split(const std::string &s, char c)
+{
+    std::vector<std::string> list;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, c))
+        if (!trim(item).empty())
+            list.push_back(trim(item));
+    return list;
+}
+
+// Reads the fixed net names; only the first name of a net is kept, as in ClassSimZ80_AVX2::loadNetNames()
+static bool loadNetNames(const std::string &fileName)
+{
+    std::ifstream in(fileName);
+    if (!in)
+        return false;
+    std::map<std::string, net_t> nums;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t comment = line.find('/');
+        if (comment != std::string::npos)
+            line = trim(line.substr(0, comment));
+        if ((line.find(':') == std::string::npos) || line.empty())
+            continue;
+        line.pop_back();
+        std::vector<std::string> list = split(line, ':');
+        if (list.size() != 2)
+            continue;
+        net_t n = net_t(strtoul(list[1].c_str(), nullptr, 10));
+        if (!nums.count(list[0]) && !names.count(n))
+        {
+            nums[list[0]] = n;
+            names[n] = list[0];
+        }
+    }
+    return (nums["vss"] == 1) && (nums["vcc"] == 2) && (nums["clk"] == 3);
+}
+
+// Reads the transistors, skipping the pull-ups, and normalizes c1 to never be a power net (or clk)
+static bool loadTransdefs(const std::string &fileName)
+{
+    std::ifstream in(fileName);
+    if (!in)
+        return false;
+    std::string line;
+    unsigned pull_ups = 0;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || (line[0] != '['))
+            continue;
+        std::replace(line.begin(), line.end(), '[', ' ');
+        std::replace(line.begin(), line.end(), ']', ' ');
+        std::vector<std::string> list = split(line, ',');
+        if ((list.size() != 14) || (list[0].size() < 2))
+            continue;
+        if (list[13] == "true")
+        {
+            pull_ups++;
+            continue;
+        }
+        tran_t i = tran_t(strtoul(list[0].c_str() + 1, nullptr, 10));
+        if (i >= MAX_TRANS)
+            return false;
+        transGate[i] = net_t(strtoul(list[1].c_str(), nullptr, 10));
+        transC1[i] = net_t(strtoul(list[2].c_str(), nullptr, 10));
+        transC2[i] = net_t(strtoul(list[3].c_str(), nullptr, 10));
+        if (transC1[i] <= 3)
+            std::swap(transC1[i], transC2[i]);
+        if (std::max({ transGate[i], transC1[i], transC2[i] }) >= MAX_NETS)
+            return false;
+        gates[transGate[i]].push_back(i);
+        edges[transC1[i]].push_back({ i, transC2[i] });
+        edges[transC2[i]].push_back({ i, transC1[i] });
+    }
+    return pull_ups == 32;
+}
+
+// Reads the nets with a pull-up resistor; the last segment of a net decides, as in ClassSimZ80_AVX2::loadPullups()
+static bool loadPullups(const std::string &fileName)
+{
+    std::ifstream in(fileName);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || (line[0] != '['))
+            continue;
+        std::vector<std::string> list = split(line.substr(1), ',');
+        if (list.size() <= 4)
+            continue;
+        size_t i = strtoul(list[0].c_str(), nullptr, 10);
+        if (i >= MAX_NETS)
+            return false;
+        pullup[i] = list[1].find('+') != std::string::npos;
+    }
+    return true;
+}
+
+// Channel-connected components, built the same way as ClassSimZ80_AVX2::buildComponents()
+static void buildComponents(size_t nets)
+{
+    std::vector<net_t> parent(nets);
+    auto find = [&](net_t n)
+    {
+        while (parent[n] != n)
+            n = parent[n] = parent[parent[n]];
+        return n;
+    };
+    for (size_t n = 0; n < nets; n++)
+        parent[n] = net_t(n);
+    for (size_t t = 0; t < transGate.size(); t++)
+    {
+        if (!transGate[t] || (transC1[t] <= npwr) || (transC2[t] <= npwr))
+            continue;
+        net_t a = find(transC1[t]), b = find(transC2[t]);
+        if (a != b)
+            parent[std::max(a, b)] = std::min(a, b);
+    }
+    ccc.resize(nets);
+    for (size_t n = 0; n < nets; n++)
+    {
+        ccc[n] = find(net_t(n));
+        cccWords[ccc[n]] |= (1ULL << (n >> 6)) | 1ULL;
+        cccSize[ccc[n]]++;
+    }
+}
+
+static std::string label(net_t n)
+{
+    return names.count(n) ? (" // " + names[n]) : std::string();
+}
+
+template<typename T, typename F>
+static void writeTable(FILE *f, const char *decl, const std::vector<T> &v, F format)
+{
+    fprintf(f, "%s =\n{", decl);
+    for (size_t i = 0; i < v.size(); i++)
+        fprintf(f, "%s%s%s", (i % 16) ? " " : "\n    ", format(v[i]).c_str(), (i + 1 < v.size()) ? "," : "");
+    fprintf(f, "\n};\n\n");
+}
+
+static bool writeSource(const std::string &fileName)
+{
+    FILE *f = fopen(fileName.c_str(), "w");
+    if (!f)
+        return false;
+    const size_t nets = edges.size(), trans = transGate.size();
+
+    fprintf(f, "// Generated by NetlistCompiler from transdefs.js, segdefs.js and nodenames.js. Do not edit.\n");
+    fprintf(f, "#include \"ClassSimZ80_Compiled.h\"\n\n");
+    fprintf(f, "typedef ClassSimZ80_Compiled S;\n");
+    fprintf(f, "typedef CompiledNetlist N;\n\n");
+    fprintf(f, "static_assert((MAX_NETS == %zu) && (MAX_TRANS == %zu), \"AppTypes.h has changed since the netlist was compiled\");\n\n", nets, trans);
+
+    // Nets of the components with more than one net get their own search functions; a net alone in its
+    // component (it may only connect to the power nets) is resolved by the simulator using the edges table
+    auto searched = [&](size_t n) { return (n > npwr) && (cccSize[ccc[n]] > 1); };
+    fprintf(f, "//=============================================================================\n");
+    fprintf(f, "// GROUP SEARCH: e<net> continues the depth-first search from a net just added to the group\n");
+    fprintf(f, "//=============================================================================\n\n");
+    for (size_t n = 0; n < nets; n++)
+        if (searched(n))
+            fprintf(f, "static void e%zu(S &s);\n", n);
+    for (size_t n = 0; n < nets; n++)
+    {
+        if (!searched(n))
+            continue;
+        fprintf(f, "\nstatic void e%zu(S &s)%s\n{\n", n, label(net_t(n)).c_str());
+        for (const Edge &e : edges[n])
+        {
+            if (e.other == n)
+                continue; // A shorted transistor leads back to the net itself, which is always in the group
+            if (e.other <= npwr)
+                fprintf(f, "    if (N::on(s, %u)) N::visitPower(s, %u);\n", e.t, e.other);
+            else
+                fprintf(f, "    if (N::on(s, %u) && N::visit(s, %u)) e%u(s);\n", e.t, e.other, e.other);
+        }
+        fprintf(f, "}\n");
+    }
+
+    fprintf(f, "\n//=============================================================================\n");
+    fprintf(f, "// GROUP ENTRY: g<net> clears the bitset words of the net's component and starts the search\n");
+    fprintf(f, "//=============================================================================\n");
+    for (size_t n = 0; n < nets; n++)
+    {
+        if (!searched(n))
+            continue;
+        fprintf(f, "\nstatic void g%zu(S &s)\n{\n", n);
+        for (unsigned w = 0; w < 64; w++)
+            if (cccWords[ccc[n]] & (1ULL << w))
+                fprintf(f, "    N::clear(s, %u);\n", w);
+        fprintf(f, "    N::start(s, %zu);\n    e%zu(s);\n}\n", n, n);
+    }
+
+    fprintf(f, "\n//=============================================================================\n");
+    fprintf(f, "// TABLES\n");
+    fprintf(f, "//=============================================================================\n\n");
+    std::vector<std::string> g(nets, "nullptr");
+    for (size_t n = 0; n < nets; n++)
+        if (searched(n))
+            g[n] = "g" + std::to_string(n);
+    auto str = [](const std::string &s) { return s; };
+    auto num = [](uint64_t v) { return std::to_string(v); };
+    writeTable(f, "const N::Fn N::group[MAX_NETS]", g, str);
+    writeTable(f, "const net_t N::transGate[MAX_TRANS]", transGate, num);
+    writeTable(f, "const net_t N::transC1[MAX_TRANS]", transC1, num);
+    writeTable(f, "const net_t N::transC2[MAX_TRANS]", transC2, num);
+
+    std::vector<uint32_t> edgeStart { 0 }, fanoutStart { 0 };
+    std::vector<std::string> edgeList, fanout;
+    std::vector<uint64_t> words(nets);
+    for (size_t n = 0; n < nets; n++)
+    {
+        for (const Edge &e : edges[n])
+            edgeList.push_back("{" + std::to_string(e.t) + "," + std::to_string(e.other) + "}");
+        for (tran_t t : gates[n])
+            fanout.push_back("{" + std::to_string(t) + "," + std::to_string(transC1[t]) + "," + std::to_string(transC2[t]) + "}");
+        edgeStart.push_back(uint32_t(edgeList.size()));
+        fanoutStart.push_back(uint32_t(fanout.size()));
+        words[n] = cccWords[ccc[n]];
+    }
+    writeTable(f, "const uint32_t N::edgeStart[MAX_NETS + 1]", edgeStart, num);
+    writeTable(f, "const NetEdge N::edges[]", edgeList, str);
+    writeTable(f, "const uint32_t N::fanoutStart[MAX_NETS + 1]", fanoutStart, num);
+    writeTable(f, "const GateEdge N::fanout[]", fanout, str);
+    writeTable(f, "const uint64_t N::cccWords[MAX_NETS]", words, [](uint64_t v) { return std::to_string(v) + "ULL"; });
+    std::vector<int> pulls(pullup.begin(), pullup.end());
+    writeTable(f, "const bool N::pullup[MAX_NETS]", pulls, [](int v) { return std::string(v ? "1" : "0"); });
+
+    return fclose(f) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <resource directory> <output file>\n", argv[0]);
+        return 1;
+    }
+    const std::string dir = argv[1];
+    transGate.resize(MAX_TRANS);
+    transC1.resize(MAX_TRANS);
+    transC2.resize(MAX_TRANS);
+    gates.resize(MAX_NETS);
+    edges.resize(MAX_NETS);
+    pullup.resize(MAX_NETS);
+    if (!loadNetNames(dir + "/nodenames.js"))
+    {
+        fprintf(stderr, "Error loading nodenames.js or vss,vcc,clk are not numbered 1,2,3\n");
+        return 1;
+    }
+    if (!loadTransdefs(dir + "/transdefs.js"))
+    {
+        fprintf(stderr, "Error loading transdefs.js: unexpected number of pull-ups or a netlist larger than AppTypes.h\n");
+        return 1;
+    }
+    if (!loadPullups(dir + "/segdefs.js"))
+    {
+        fprintf(stderr, "Error loading segdefs.js\n");
+        return 1;
+    }
+    buildComponents(MAX_NETS);
+    if (!writeSource(argv[2]))
+    {
+        fprintf(stderr, "Error writing %s\n", argv[2]);
+        return 1;
+    }
+    printf("Compiled the netlist of %d transistors and %d nets into %s\n", MAX_TRANS, MAX_NETS, argv[2]);
+    return 0;
+}